@@ -0,0 +1,415 @@
+// Benchmark driver: generates deterministic corpora, runs every codec and
+// thread count over them and reports throughput, ratio and peak RSS as CSV
+// and/or JSON. Each run executes in a forked child so its peak RSS can be
+// read back with wait4().
+#include "Adaptive.hpp"
+#include "Huffman.hpp"
+#include "LZH.hpp"
+#include "LZW.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Corpora. Only raw mt19937_64 output is used (no <random> distributions),
+// so the bytes are identical across standard libraries and platforms.
+// ---------------------------------------------------------------------------
+
+const char* const WORDS[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on",
+    "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they",
+    "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if", "more", "when",
+    "will", "would", "who", "so", "no", "compression", "entropy", "symbol", "stream", "block", "table",
+    "dictionary", "frequency", "encoder", "decoder", "buffer", "thread", "memory", "archive", "format",
+};
+constexpr size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+const char* const LEVELS[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+const char* const COMPONENTS[] = {"http", "db", "cache", "auth", "scheduler", "storage"};
+const char* const MESSAGES[] = {
+    "request completed", "connection opened", "connection closed", "cache miss",
+    "retrying operation", "slow query detected", "token refreshed", "job finished",
+};
+
+void appendRandom(std::string& out, size_t size, std::mt19937_64& rng) {
+    while (out.size() < size) {
+        uint64_t w = rng();
+        size_t n = std::min<size_t>(8, size - out.size());
+        out.append(reinterpret_cast<const char*>(&w), n);
+    }
+}
+
+std::string makeCorpus(const std::string& kind, size_t size) {
+    // Seed from the corpus name (FNV-1a) so each kind has its own stream.
+    uint64_t seed = 14695981039346656037ull;
+    for (char ch : kind) seed = (seed ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+    std::mt19937_64 rng(seed);
+    std::string out;
+    out.reserve(size + 256);
+
+    if (kind == "random") {
+        appendRandom(out, size, rng);
+    } else if (kind == "text") {
+        // Word choice skewed towards the front of the list, roughly Zipfian.
+        size_t wordsOnLine = 0;
+        while (out.size() < size) {
+            uint64_t r = rng();
+            size_t idx = ((r & 0xFFFF) % WORD_COUNT) * ((r >> 16 & 0xFFFF) % WORD_COUNT) / WORD_COUNT;
+            out += WORDS[idx];
+            if (++wordsOnLine >= 8 + (r >> 32) % 8) {
+                out += ".\n";
+                wordsOnLine = 0;
+            } else {
+                out += (r >> 40) % 16 == 0 ? ", " : " ";
+            }
+        }
+    } else if (kind == "log") {
+        uint64_t millis = 0;
+        uint64_t requestId = 100000;
+        char line[160];
+        while (out.size() < size) {
+            uint64_t r = rng();
+            millis += r % 250;
+            uint64_t sec = millis / 1000;
+            int n = std::snprintf(line, sizeof(line),
+                                  "2024-03-01T%02u:%02u:%02u.%03u %-5s [%s] %s id=%llu latency=%ums\n",
+                                  unsigned(sec / 3600 % 24), unsigned(sec / 60 % 60), unsigned(sec % 60),
+                                  unsigned(millis % 1000), LEVELS[(r >> 8) % 6], COMPONENTS[(r >> 16) % 6],
+                                  MESSAGES[(r >> 24) % 8], static_cast<unsigned long long>(requestId++),
+                                  unsigned((r >> 32) % 900 + 1));
+            out.append(line, static_cast<size_t>(n));
+        }
+    } else if (kind == "repetitive") {
+        // A 4 KiB chunk repeated, with one byte changed per copy.
+        std::string chunk;
+        appendRandom(chunk, 4096, rng);
+        while (out.size() < size) {
+            chunk[rng() % chunk.size()] = static_cast<char>(rng());
+            out += chunk;
+        }
+    } else if (kind == "binary") {
+        // Fixed-size records: sequential id, small type tag, random-walk
+        // sample and a slowly increasing timestamp.
+        uint32_t id = 0;
+        uint64_t timestamp = 1700000000000ull;
+        int32_t sample = 0;
+        while (out.size() < size) {
+            uint64_t r = rng();
+            uint16_t type = static_cast<uint16_t>(r % 5);
+            sample += static_cast<int32_t>((r >> 8) % 201) - 100;
+            timestamp += (r >> 16) % 1000;
+            out.append(reinterpret_cast<const char*>(&id), sizeof(id));
+            out.append(reinterpret_cast<const char*>(&type), sizeof(type));
+            out.append(reinterpret_cast<const char*>(&sample), sizeof(sample));
+            out.append(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+            ++id;
+        }
+    } else {
+        throw std::runtime_error("Unknown corpus: " + kind);
+    }
+    out.resize(size);
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+struct Measurement {
+    double seconds = 0;
+    long peakRssKb = 0;
+    bool ok = false;
+};
+
+// Runs `fn` in a child process with stdout/stderr silenced.
+Measurement runChild(const std::function<void()>& fn) {
+    std::cout.flush();
+    std::cerr.flush();
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0) {
+        int devNull = ::open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        int code = 0;
+        try {
+            fn();
+        } catch (...) {
+            code = 1;
+        }
+        std::cout.flush();
+        _exit(code);
+    }
+
+    int status = 0;
+    struct rusage usage {};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        throw std::runtime_error("wait4 failed");
+    }
+    Measurement m;
+    m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m.peakRssKb = usage.ru_maxrss;
+    m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return m;
+}
+
+// Best (fastest) of `repeat` runs; the peak RSS is the largest seen.
+Measurement measure(int repeat, const std::function<void()>& fn) {
+    Measurement best;
+    for (int i = 0; i < repeat; ++i) {
+        Measurement m = runChild(fn);
+        if (!m.ok) return m;
+        if (i == 0 || m.seconds < best.seconds) best.seconds = m.seconds;
+        best.peakRssKb = std::max(best.peakRssKb, m.peakRssKb);
+        best.ok = true;
+    }
+    return best;
+}
+
+bool sameContents(const fs::path& a, const fs::path& b) {
+    if (fs::file_size(a) != fs::file_size(b)) return false;
+    std::ifstream fa(a, std::ios::binary);
+    std::ifstream fb(b, std::ios::binary);
+    std::vector<char> ba(1 << 20), bb(1 << 20);
+    while (fa && fb) {
+        fa.read(ba.data(), ba.size());
+        fb.read(bb.data(), bb.size());
+        if (fa.gcount() != fb.gcount() || std::memcmp(ba.data(), bb.data(), fa.gcount()) != 0) return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Runs and reporting
+// ---------------------------------------------------------------------------
+
+struct Config {
+    std::string codec;   // huffman | huffman-blocks | lzw | lzh | auto
+    int threads;
+};
+
+struct Result {
+    std::string corpus;
+    Config config;
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+    Measurement compress;
+    Measurement decompress;
+    bool roundTrip = false;
+};
+
+void compressWith(const Config& c, const std::string& in, const std::string& out) {
+    if (c.codec == "lzw") {
+        LZW().compress(in, out);
+    } else if (c.codec == "lzh") {
+        LZH().compress(in, out, c.threads);
+    } else if (c.codec == "auto") {
+        Adaptive().compress(in, out, c.threads);
+    } else if (c.codec == "huffman-blocks") {
+        Huffman().compressMultiThreaded(in, out, c.threads);
+    } else {
+        Huffman().compress(in, out);
+    }
+}
+
+void decompressWith(const Config& c, const std::string& in, const std::string& out) {
+    if (c.codec == "lzw") {
+        LZW().decompress(in, out);
+    } else if (c.codec == "lzh") {
+        LZH().decompress(in, out, c.threads);
+    } else if (c.codec == "auto") {
+        Adaptive().decompress(in, out, c.threads);
+    } else {
+        Huffman().decompress(in, out, c.threads);
+    }
+}
+
+double mbPerSecond(uint64_t bytes, const Measurement& m) {
+    return m.ok && m.seconds > 0 ? (bytes / (1024.0 * 1024.0)) / m.seconds : 0.0;
+}
+
+void writeCsv(std::ostream& out, const std::vector<Result>& results) {
+    out << "corpus,codec,threads,input_bytes,output_bytes,ratio,compress_mbps,decompress_mbps,"
+           "compress_peak_rss_kb,decompress_peak_rss_kb,roundtrip_ok\n";
+    for (const Result& r : results) {
+        out << r.corpus << ',' << r.config.codec << ',' << r.config.threads << ',' << r.inputBytes << ','
+            << r.outputBytes << ',' << (r.inputBytes ? double(r.outputBytes) / r.inputBytes : 0.0) << ','
+            << mbPerSecond(r.inputBytes, r.compress) << ',' << mbPerSecond(r.inputBytes, r.decompress) << ','
+            << r.compress.peakRssKb << ',' << r.decompress.peakRssKb << ',' << (r.roundTrip ? 1 : 0) << '\n';
+    }
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "  {\"corpus\": \"" << r.corpus << "\", \"codec\": \"" << r.config.codec
+            << "\", \"threads\": " << r.config.threads << ", \"input_bytes\": " << r.inputBytes
+            << ", \"output_bytes\": " << r.outputBytes
+            << ", \"ratio\": " << (r.inputBytes ? double(r.outputBytes) / r.inputBytes : 0.0)
+            << ", \"compress_mbps\": " << mbPerSecond(r.inputBytes, r.compress)
+            << ", \"decompress_mbps\": " << mbPerSecond(r.inputBytes, r.decompress)
+            << ", \"compress_peak_rss_kb\": " << r.compress.peakRssKb
+            << ", \"decompress_peak_rss_kb\": " << r.decompress.peakRssKb
+            << ", \"roundtrip_ok\": " << (r.roundTrip ? "true" : "false") << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+void printHelp() {
+    std::cout << "Usage: compress_bench [options]\n"
+              << "  --size MB          Size of each corpus (default 16)\n"
+              << "  --corpora LIST     Comma-separated subset of random,text,log,repetitive,binary\n"
+              << "  --threads LIST     Thread counts for the block codec (default 1,2,4,... up to cores)\n"
+              << "  --repeat N         Runs per measurement, fastest is kept (default 3)\n"
+              << "  --csv PATH         Write CSV results to PATH\n"
+              << "  --json PATH        Write JSON results to PATH\n"
+              << "  --workdir DIR      Directory for corpora and outputs (default: system temp)\n"
+              << "Without --csv or --json, CSV is written to stdout.\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t sizeMb = 16;
+    int repeat = 3;
+    std::vector<std::string> corpora = {"random", "text", "log", "repetitive", "binary"};
+    std::vector<int> threadCounts;
+    std::string csvPath, jsonPath;
+    fs::path workDir = fs::temp_directory_path() / ("compress-bench-" + std::to_string(getpid()));
+    bool ownWorkDir = true;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--help") {
+                printHelp();
+                return 0;
+            } else if (arg == "--size" && hasValue) {
+                sizeMb = std::stoul(argv[++i]);
+            } else if (arg == "--corpora" && hasValue) {
+                corpora = splitList(argv[++i]);
+            } else if (arg == "--threads" && hasValue) {
+                for (const std::string& t : splitList(argv[++i])) threadCounts.push_back(std::stoi(t));
+            } else if (arg == "--repeat" && hasValue) {
+                repeat = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--csv" && hasValue) {
+                csvPath = argv[++i];
+            } else if (arg == "--json" && hasValue) {
+                jsonPath = argv[++i];
+            } else if (arg == "--workdir" && hasValue) {
+                workDir = argv[++i];
+                ownWorkDir = false;
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                printHelp();
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid option value.\n";
+        return 1;
+    }
+
+    if (threadCounts.empty()) {
+        int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int t = 1; t < cores; t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(cores);
+    }
+    std::vector<Config> configs = {{"huffman", 1}, {"lzw", 1}};
+    for (int t : threadCounts) configs.push_back({"huffman-blocks", t});
+    for (int t : threadCounts) configs.push_back({"lzh", t});
+    for (int t : threadCounts) configs.push_back({"auto", t});
+
+    std::vector<Result> results;
+    try {
+        fs::create_directories(workDir);
+        for (const std::string& corpus : corpora) {
+            fs::path input = workDir / (corpus + ".raw");
+            {
+                // Built and written before any fork, then released, so the
+                // children do not inherit it in their resident set.
+                std::string data = makeCorpus(corpus, sizeMb << 20);
+                std::ofstream(input, std::ios::binary).write(data.data(), data.size());
+            }
+            for (const Config& c : configs) {
+                fs::path packed = workDir / (corpus + ".packed");
+                fs::path restored = workDir / (corpus + ".restored");
+                Result r;
+                r.corpus = corpus;
+                r.config = c;
+                r.inputBytes = fs::file_size(input);
+                r.compress = measure(repeat, [&] { compressWith(c, input.string(), packed.string()); });
+                if (r.compress.ok) {
+                    r.outputBytes = fs::file_size(packed);
+                    r.decompress = measure(repeat, [&] { decompressWith(c, packed.string(), restored.string()); });
+                    r.roundTrip = r.decompress.ok && sameContents(input, restored);
+                }
+                std::cerr << corpus << " " << c.codec << " x" << c.threads << ": "
+                          << mbPerSecond(r.inputBytes, r.compress) << " / "
+                          << mbPerSecond(r.inputBytes, r.decompress) << " MB/s"
+                          << (r.roundTrip ? "" : "  ROUND TRIP FAILED") << "\n";
+                results.push_back(r);
+                fs::remove(packed);
+                fs::remove(restored);
+            }
+            fs::remove(input);
+        }
+        if (ownWorkDir) fs::remove_all(workDir);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream out(csvPath);
+        writeCsv(out, results);
+    }
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        writeJson(out, results);
+    }
+    if (csvPath.empty() && jsonPath.empty()) {
+        writeCsv(std::cout, results);
+    }
+
+    bool allOk = std::all_of(results.begin(), results.end(), [](const Result& r) { return r.roundTrip; });
+    return allOk ? 0 : 2;
+}
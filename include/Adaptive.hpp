@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// `-algo auto`: splits the input into blocks and, per block, picks whichever
+// of Huffman and LZW is expected to be smaller, or stores the block raw when
+// neither helps (already-compressed media, random data).
+class Adaptive {
+public:
+    void compress(const std::string& inputFile, const std::string& outputFile, int numThreads = 1);
+    void decompress(const std::string& inputFile, const std::string& outputFile, int numThreads = 1);
+
+    // Upper bound on block buffers held by the streaming block pipeline.
+    void setMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+
+    enum class Method : uint8_t { Stored = 0, Huffman = 1, LZW = 2 };
+
+private:
+    // Container:
+    //   "ADBK" | version u8 | blockSize u32
+    //   frame* : rawSize u32 | method u8 | payloadSize u32 | crc32c u32 | payload
+    //   rawSize 0 terminator | crc32c u32 of the whole stream
+    //   index  : blockCount u32 | (rawOffset u64, frameOffset u64)*
+    //   footer : indexOffset u64 | "ADIX"
+    // Huffman and LZW payloads are complete single-stream buffers as produced
+    // by Huffman::compressBuffer / LZW::compressBuffer. The frame checksum is
+    // over the raw block, so stored blocks are covered too.
+    friend class RangeReader;
+    static constexpr char BLOCK_MAGIC[4] = {'A', 'D', 'B', 'K'};
+    static constexpr char INDEX_MAGIC[4] = {'A', 'D', 'I', 'X'};
+    static constexpr uint8_t BLOCK_VERSION = 2;
+    static constexpr uint32_t DEFAULT_BLOCK_SIZE = 1 << 20;
+    static constexpr size_t FRAME_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + 2 * sizeof(uint32_t);
+
+    static void encodeBlock(const std::string& block, std::string& frame);
+    static void decodeBlock(const std::string& frame, std::string& block);
+    // Rejects frames larger than the container's blockSize, or with a payload
+    // larger than the raw block, before allocating for them.
+    static bool readFrame(std::istream& in, uint32_t blockSize, std::string& frame);
+
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+    size_t memoryLimit = DEFAULT_MEMORY_LIMIT;
+};
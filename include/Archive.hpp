@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Multi-file archives: every file, or every 1 MiB chunk of a large file, is
+// compressed as its own task on a work-stealing thread pool, so one process
+// handles thousands of small files on all cores. Chunks are appended in
+// completion order and located through a central index at the end.
+class Archive {
+public:
+    // Codec for the chunks: "huffman", "lzw" or "lzh" (default). Chunks that
+    // do not shrink are stored raw.
+    void setCodec(const std::string& name);
+
+    // Inputs are files or directories (walked recursively). Paths are stored
+    // as given, minus any leading '/'.
+    void create(const std::string& outputFile, const std::vector<std::string>& inputs, int numThreads = 1);
+    // Recreates every entry under outputDir.
+    void extract(const std::string& archiveFile, const std::string& outputDir, int numThreads = 1);
+    // Decodes and checks every chunk without writing anything.
+    void verify(const std::string& archiveFile, int numThreads = 1);
+
+    // One path per line; "-" reads the list from stdin.
+    static std::vector<std::string> readFileList(const std::string& listFile);
+
+    enum class Method : uint8_t { Stored = 0, Huffman = 1, LZW = 2, LZH = 3 };
+
+private:
+    // Layout:
+    //   "FCAR" | version u8
+    //   chunk payloads, in completion order
+    //   index  : entryCount u32
+    //            entry* : pathLen u16 | path | rawSize u64 | chunkCount u32
+    //                     chunk* : method u8 | rawSize u32 | offset u64 | payloadSize u32 | crc32c u32
+    //   footer : indexOffset u64 | "FCIX"
+    // The chunk checksum is over the raw chunk, so stored chunks are covered.
+    static constexpr char MAGIC[4] = {'F', 'C', 'A', 'R'};
+    static constexpr char INDEX_MAGIC[4] = {'F', 'C', 'I', 'X'};
+    static constexpr uint8_t VERSION = 2;
+    static constexpr uint32_t CHUNK_SIZE = 1 << 20;
+
+    struct Chunk {
+        Method method = Method::Stored;
+        uint32_t rawSize = 0;
+        uint64_t offset = 0;
+        uint32_t payloadSize = 0;
+        uint32_t crc = 0;
+    };
+
+    struct Entry {
+        std::string path;        // archive name, '/'-separated
+        std::string source;      // where create() reads it from
+        uint64_t rawSize = 0;
+        std::vector<Chunk> chunks;
+    };
+
+    static std::vector<Entry> collectEntries(const std::vector<std::string>& inputs);
+    static std::string archiveName(const std::string& path);
+    static std::vector<Entry> readIndex(std::istream& in, const std::string& archiveFile);
+    // Reads, decodes and checks chunk c of e into a per-thread buffer.
+    static const std::string& decodeChunk(const std::string& archiveFile, const Entry& e, size_t c);
+    static std::vector<Entry> openIndex(const std::string& archiveFile);
+
+    Method method = Method::LZH;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Positioned reads and writes that complete in the background, so a file can
+// keep several requests in flight while the calling thread codes other data.
+// On Linux requests go through an io_uring; where no ring is available (old
+// kernels, seccomp filters, other systems) a few threads run them with
+// pread/pwrite instead. Not available on Windows.
+class IoQueue {
+public:
+    enum class Backend { Auto, Uring, Threads, Off };
+
+    // Process-wide choice, `--io` on the command line. Auto tries io_uring
+    // and falls back to threads; Off keeps all file I/O synchronous.
+    static void setBackend(Backend backend);
+    static Backend backend();
+    static bool parseBackend(const std::string& name, Backend& backend);
+
+    // A queue taking up to `depth` requests at once, or nullptr when async
+    // I/O is off or unavailable.
+    static std::unique_ptr<IoQueue> create(unsigned depth);
+    virtual ~IoQueue() = default;
+
+    IoQueue(const IoQueue&) = delete;
+    IoQueue& operator=(const IoQueue&) = delete;
+
+    struct Completion {
+        uint64_t tag;
+        int64_t result;     // bytes transferred (may be short) or -errno
+    };
+
+    // The buffer must stay valid until the request's completion is returned
+    // by wait(), or until the queue is destroyed, which waits for whatever is
+    // still in flight. Submitting more than `depth` requests at once is an
+    // error.
+    virtual void read(int fd, void* data, size_t size, uint64_t offset, uint64_t tag) = 0;
+    virtual void write(int fd, const void* data, size_t size, uint64_t offset, uint64_t tag) = 0;
+    // Blocks until a request finishes; completions arrive in any order.
+    virtual Completion wait() = 0;
+
+    virtual const char* name() const = 0;
+
+protected:
+    IoQueue() = default;
+};
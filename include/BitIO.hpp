@@ -0,0 +1,164 @@
+#pragma once
+#include "Stats.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Packs variable-length codes MSB-first into a 64-bit accumulator and flushes
+// whole words into a fixed-size byte buffer, so memory use stays constant no
+// matter how many bits are written. The buffer drains either into an ostream
+// or by appending to an in-memory string.
+class BitWriter {
+public:
+    explicit BitWriter(std::ostream& out, size_t bufferSize = 1 << 16)
+        : out(&out), buffer(bufferSize) {}
+
+    explicit BitWriter(std::string& target, size_t bufferSize = 1 << 16)
+        : target(&target), buffer(bufferSize) {}
+
+    ~BitWriter() {
+        // Destructors must not throw; callers that care about errors call flush().
+        try { flush(); } catch (...) {}
+    }
+
+    // Append the low `len` bits of `code` (len < 64).
+    inline void write(uint64_t code, unsigned len) {
+        if (len < freeBits) {
+            acc = (acc << len) | code;
+            freeBits -= len;
+            return;
+        }
+        unsigned rest = len - freeBits;
+        acc = (acc << freeBits) | (code >> rest);
+        emitWord(acc);
+        acc = rest ? (code & ((uint64_t(1) << rest) - 1)) : 0;
+        freeBits = 64 - rest;
+    }
+
+    // Write out all pending bits, zero-padding the last byte.
+    void flush() {
+        unsigned used = 64 - freeBits;
+        if (used > 0) {
+            uint64_t word = acc << freeBits;
+            unsigned bytes = (used + 7) / 8;
+            for (unsigned i = 0; i < bytes; ++i) {
+                putByte(static_cast<unsigned char>(word >> (56 - 8 * i)));
+            }
+            acc = 0;
+            freeBits = 64;
+        }
+        drain();
+        if (out && !*out) {
+            throw std::runtime_error("BitWriter: write failed");
+        }
+    }
+
+private:
+    inline void emitWord(uint64_t word) {
+        if (pos + 8 > buffer.size()) drain();
+        for (int i = 0; i < 8; ++i) {
+            buffer[pos++] = static_cast<char>(word >> (56 - 8 * i));
+        }
+    }
+
+    inline void putByte(unsigned char b) {
+        if (pos == buffer.size()) drain();
+        buffer[pos++] = static_cast<char>(b);
+    }
+
+    void drain() {
+        if (pos == 0) return;
+        if (out) {
+            FC_STAGE(Write);
+            out->write(buffer.data(), pos);
+        } else {
+            target->append(buffer.data(), pos);
+        }
+        pos = 0;
+    }
+
+    std::ostream* out = nullptr;
+    std::string* target = nullptr;
+    std::vector<char> buffer;
+    size_t pos = 0;
+    uint64_t acc = 0;
+    unsigned freeBits = 64;
+};
+
+// Reads an MSB-first bitstream through a 64-bit accumulator. After refill()
+// at least 56 bits can be peeked (fewer only at the very end of the stream,
+// where missing bits read as zero). Works over an in-memory span or pulls
+// bytes from an istream through an internal buffer.
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size)
+        : cur(data), end(data + size) {}
+
+    explicit BitReader(std::istream& in, size_t bufferSize = 1 << 16)
+        : in(&in), storage(bufferSize) {
+        fillBuffer();
+    }
+
+    inline void refill() {
+        if (bitCount > 56) return;
+        if (end - cur >= 8) {
+            // Branch-light path: load 8 bytes, keep as many as fit.
+            acc |= loadBigEndian64(cur) >> bitCount;
+            cur += (63 - bitCount) >> 3;
+            bitCount |= 56;
+            return;
+        }
+        while (bitCount <= 56) {
+            if (cur == end && !fillBuffer()) return;
+            acc |= static_cast<uint64_t>(*cur++) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+
+    // Top `n` bits of the accumulator, 1 <= n <= 56.
+    inline uint64_t peek(unsigned n) const { return acc >> (64 - n); }
+
+    inline void consume(unsigned n) {
+        acc <<= n;
+        bitCount -= static_cast<int>(n);
+    }
+
+    // True once more bits were consumed than the stream contained.
+    bool overrun() const { return bitCount < 0; }
+
+    // Bytes taken from the istream so far, read-ahead included.
+    uint64_t bytesPulled() const { return pulled; }
+
+private:
+    static inline uint64_t loadBigEndian64(const unsigned char* p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    bool fillBuffer() {
+        if (!in || !*in) return false;
+        FC_STAGE(Read);
+        size_t remaining = end - cur;
+        if (remaining && cur != storage.data()) {
+            std::copy(cur, end, storage.data());
+        }
+        in->read(reinterpret_cast<char*>(storage.data() + remaining), storage.size() - remaining);
+        cur = storage.data();
+        end = cur + remaining + in->gcount();
+        pulled += static_cast<uint64_t>(in->gcount());
+        return in->gcount() > 0;
+    }
+
+    std::istream* in = nullptr;
+    std::vector<unsigned char> storage;
+    const unsigned char* cur = nullptr;
+    const unsigned char* end = nullptr;
+    uint64_t acc = 0;
+    int bitCount = 0;
+    uint64_t pulled = 0;
+};
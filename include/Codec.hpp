@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Dictionary;
+
+// Read-only view of a byte range (a C++17 stand-in for std::span<const std::byte>).
+class ByteSpan {
+public:
+    ByteSpan() = default;
+    ByteSpan(const void* data, size_t size) : ptr(static_cast<const unsigned char*>(data)), len(size) {}
+    ByteSpan(const std::string& s) : ByteSpan(s.data(), s.size()) {}
+    ByteSpan(const std::vector<uint8_t>& v) : ByteSpan(v.data(), v.size()) {}
+
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+
+private:
+    const unsigned char* ptr = nullptr;
+    size_t len = 0;
+};
+
+// In-memory compression, independent of files and the CLI. A Codec object is
+// also its own context: tables and scratch buffers survive between calls,
+// so keep one per thread and reuse it for a stream of small payloads.
+// Nothing is printed; errors are reported as std::runtime_error.
+class Codec {
+public:
+    virtual ~Codec() = default;
+
+    // "huffman", "lzw" or "lzh"; throws for unknown names. Huffman and LZW
+    // can share a trained Dictionary across small payloads; lzh has none.
+    static std::unique_ptr<Codec> create(const std::string& name,
+                                         std::shared_ptr<const Dictionary> dictionary = nullptr);
+
+    virtual const char* name() const = 0;
+
+    // Replace `out` with the result; reusing `out` keeps its capacity.
+    void compress(ByteSpan input, std::string& out) { compressInto(input, out); }
+    void decompress(ByteSpan input, std::string& out) { decompressInto(input, out); }
+
+    std::string compress(ByteSpan input) {
+        std::string out;
+        compressInto(input, out);
+        return out;
+    }
+    std::string decompress(ByteSpan input) {
+        std::string out;
+        decompressInto(input, out);
+        return out;
+    }
+
+protected:
+    virtual void compressInto(ByteSpan input, std::string& out) = 0;
+    virtual void decompressInto(ByteSpan input, std::string& out) = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared dictionary for many small, similar payloads, built once by
+// `-mode train` from a sample corpus. It holds a canonical Huffman code
+// covering all 256 byte values and a primed LZW dictionary. Streams coded
+// with it carry only its ID instead of a code table, and LZW starts with the
+// corpus's common phrases instead of single bytes.
+class Dictionary {
+public:
+    // LZW code FIRST_CODE + i extends code `prefix` by `byte`; prefixes are
+    // single bytes or earlier phrases.
+    struct Phrase {
+        uint32_t prefix;
+        uint8_t byte;
+    };
+
+    // One sample per payload. LZW phrases are limited so that records still
+    // have half of the 2^lzwCodeBits codes for phrases of their own.
+    static std::shared_ptr<const Dictionary> train(const std::vector<std::string>& samples,
+                                                   unsigned lzwCodeBits = 16);
+    // Contents of each file, directories walked recursively in sorted order.
+    static std::vector<std::string> readSamples(const std::vector<std::string>& paths);
+
+    static std::shared_ptr<const Dictionary> load(const std::string& path);
+    static std::shared_ptr<const Dictionary> parse(const char* data, size_t size);
+    std::string serialize() const;
+    // Writes the dictionary to pathFor(dir, id()) and returns that path.
+    std::string save(const std::string& dir) const;
+
+    // CRC-32C of the dictionary contents, so equal training gives equal IDs.
+    uint32_t id() const { return dictId; }
+    static std::string formatId(uint32_t id);
+    static uint32_t parseId(const std::string& text);
+    // "<dir>/<id as 8 hex digits>.dict"
+    static std::string pathFor(const std::string& dir, uint32_t id);
+
+    // `current` when its ID matches, otherwise the dictionary stored for
+    // `id` under `dir`; throws when neither is available.
+    static std::shared_ptr<const Dictionary> resolve(const std::shared_ptr<const Dictionary>& current,
+                                                     const std::string& dir, uint32_t id);
+
+    const std::array<uint8_t, 256>& huffmanLengths() const { return lengths; }
+    unsigned lzwCodeBits() const { return codeBits; }
+    const std::vector<Phrase>& lzwPhrases() const { return phrases; }
+
+private:
+    // File layout:
+    //   "FCDT" | version u8 | Huffman code lengths 256 x u8 |
+    //   lzwCodeBits u8 | phraseCount u32 | (prefix u32, byte u8)* | id u32
+    static constexpr char MAGIC[4] = {'F', 'C', 'D', 'T'};
+    static constexpr uint8_t VERSION = 1;
+
+    Dictionary() = default;
+
+    std::array<uint8_t, 256> lengths{};
+    unsigned codeBits = 16;
+    std::vector<Phrase> phrases;
+    uint32_t dictId = 0;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file through the page cache (mmap on POSIX, a
+// file mapping on Windows), advised for sequential access.
+class MappedFile {
+public:
+    // Returns nullptr when the path cannot be mapped (pipes, special files).
+    static std::unique_ptr<MappedFile> open(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+class IoQueue;
+
+// Binary input. Regular files are memory-mapped and exposed both as a byte
+// span (zero-copy) and as an istream reading from the mapping. stdin ("-")
+// and anything that cannot be mapped fall back to buffered stream reads.
+class InputFile {
+public:
+    // Streamed is for callers that only read stream() front to back: regular
+    // files are then read ahead through an IoQueue, several buffers at a
+    // time, instead of being mapped. Without async I/O they are mapped.
+    enum class Access { Mapped, Streamed };
+
+    explicit InputFile(const std::string& path, Access access = Access::Mapped);
+    ~InputFile();
+
+    std::istream& stream() { return *in; }
+
+    bool isMapped() const { return map != nullptr; }
+    // The whole file; only valid when isMapped().
+    const unsigned char* data() const { return map->data(); }
+    size_t size() const { return map->size(); }
+
+private:
+    // Get area spanning the mapping, with seeking.
+    class SpanBuf : public std::streambuf {
+    public:
+        SpanBuf(const unsigned char* data, size_t size);
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    };
+    class PrefetchBuf;
+
+    std::unique_ptr<MappedFile> map;
+    std::unique_ptr<SpanBuf> spanBuf;
+    std::unique_ptr<std::istream> spanStream;
+    std::unique_ptr<PrefetchBuf> prefetchBuf;
+    std::unique_ptr<std::istream> prefetchStream;
+    std::vector<char> buffer;
+    std::ifstream file;
+    std::istream* in = nullptr;
+};
+
+// Binary output. When the final size is known and the target is a regular
+// file, the file is presized and written through a shared writable mapping
+// (growing if the estimate was short, truncated to the real size on close).
+// Other regular files are written through an IoQueue, so filled buffers are
+// written in the background while the next ones fill. Everything else goes
+// through a large buffer; "-" selects stdout.
+class OutputFile {
+public:
+    static constexpr uint64_t UNKNOWN_SIZE = ~uint64_t(0);
+
+    explicit OutputFile(const std::string& path, uint64_t expectedSize = UNKNOWN_SIZE);
+    ~OutputFile();
+
+    std::ostream& stream() { return *out; }
+
+    bool isMapped() const { return mappedBuf != nullptr; }
+
+    // Flushes and finalizes the file; throws if any write failed.
+    void close();
+
+private:
+    class MappedBuf;
+    class QueuedBuf;
+
+    std::unique_ptr<MappedBuf> mappedBuf;
+    std::unique_ptr<std::ostream> mappedStream;
+    std::unique_ptr<QueuedBuf> queuedBuf;
+    std::unique_ptr<std::ostream> queuedStream;
+    std::vector<char> buffer;
+    std::ofstream file;
+    std::ostream* out = nullptr;
+    bool closed = false;
+};
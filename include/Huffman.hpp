@@ -1,37 +1,190 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
 #include <string>
-#include <unordered_map>
 #include <vector>
-#include <queue>
 #include <memory>
 
+class BitReader;
+class BitWriter;
+class Dictionary;
+
 class Huffman {
 public:
     void compress(const std::string& inputFile, const std::string& outputFile);
     void compressMultiThreaded(const std::string& inputFile, const std::string& outputFile, int numThreads = 4);
-    void decompress(const std::string& inputFile, const std::string& outputFile);
+    void decompress(const std::string& inputFile, const std::string& outputFile, int numThreads = 1);
+
+    // In-memory single-stream coding; `out` is replaced with the result.
+    // Decode tables are kept on the object between calls, so reusing one
+    // Huffman per thread avoids rebuilding scratch memory for every payload.
+    void compressBuffer(const unsigned char* data, size_t size, std::string& out);
+    void decompressBuffer(const unsigned char* data, size_t size, std::string& out);
+
+    // Upper bound on block buffers held by the streaming block pipeline.
+    void setMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+
+    // With a dictionary, single-stream compression codes with its table and
+    // writes only the dictionary ID, not a code table. Decompression looks up
+    // the dictionary a stream names: this one if the IDs match, otherwise the
+    // file for that ID under the dictionary directory.
+    void setDictionary(std::shared_ptr<const Dictionary> dict);
+    void setDictionaryDir(const std::string& dir) { dictionaryDir = dir; }
+
+    // Canonical code word (MSB-first) and its length in bits.
+    struct Code {
+        uint64_t bits = 0;
+        uint8_t len = 0;
+    };
+    using Histogram = std::array<uint64_t, 256>;
+    using CodeLengths = std::array<uint8_t, 256>;
+    using CodeTable = std::array<Code, 256>;
+
+    // Byte counts; inputs above a few MiB are split across numThreads.
+    static Histogram buildFrequencyTable(const unsigned char* data, size_t size, int numThreads = 1);
+
+    // Table construction for any alphabet of `count` symbols (count <= 2^maxLen),
+    // shared with the LZ stage of LZH: length-limited code lengths, with 0 for
+    // unused symbols, and the canonical codes for a set of lengths.
+    static void buildLengths(const uint64_t* freq, size_t count, unsigned maxLen, uint8_t* lengths);
+    static void assignCanonicalCodes(const uint8_t* lengths, size_t count, Code* codes);
+
+    // Code lengths for a dictionary: every byte value gets a code, so payloads
+    // with bytes the training corpus lacked still encode.
+    static CodeLengths trainCodeLengths(const Histogram& freq);
 
 private:
-    struct Node {
-        char ch;
-        int freq;
-        std::shared_ptr<Node> left;
-        std::shared_ptr<Node> right;
-
-        Node(char c, int f) : ch(c), freq(f), left(nullptr), right(nullptr) {}
-        Node(std::shared_ptr<Node> l, std::shared_ptr<Node> r) : ch('\0'), freq(l->freq + r->freq), left(l), right(r) {}
+    static CodeLengths buildCodeLengths(const Histogram& freq);
+    static CodeTable buildCanonicalCodes(const CodeLengths& lengths);
+
+    // Code lengths are capped so every code fits one table lookup pair.
+    static constexpr unsigned MAX_CODE_LEN = 15;
+
+    // Table-driven decoding: an 11-bit peek resolves one or two symbols;
+    // longer codes go through a per-prefix second-level table of at most
+    // MAX_CODE_LEN - LOOKUP_BITS bits.
+    static constexpr unsigned LOOKUP_BITS = 11;
+
+    struct DecodeEntry {
+        uint8_t symbols[2] = {0, 0};
+        uint8_t count = 0;      // symbols resolved by this entry (0 = long code or invalid)
+        uint8_t len1 = 0;       // bits used by the first symbol
+        uint8_t totalLen = 0;   // bits used by all resolved symbols
+        uint8_t subBits = 0;    // width of the second-level table
+        uint32_t subOffset = 0;
+    };
+    struct SubEntry {
+        uint8_t symbol = 0;
+        uint8_t len = 0;        // full code length, 0 = invalid
     };
-    struct Compare {
-        bool operator()(const std::shared_ptr<Node>& a, const std::shared_ptr<Node>& b) {
-            return a->freq > b->freq;
-        }
+    struct DecodeTable {
+        std::vector<DecodeEntry> primary;
+        std::vector<SubEntry> secondary;
+        unsigned maxLen = 0;    // longest code, selects the decode kernel
     };
 
-    std::unordered_map<char, int> buildFrequencyTable(const std::string& inputFile);
-    std::shared_ptr<Node> buildTree(const std::unordered_map<char, int>& freqMap);
-    void buildEncodingTable(std::shared_ptr<Node> root, const std::string& str);
+    // Rebuilds `table` in place, reusing its storage.
+    static void buildDecodeTable(const CodeLengths& lengths, DecodeTable& table);
+    // Runs the kernel specialized for the table's longest code: when every
+    // code fits LOOKUP_BITS, the second-level path compiles away and one
+    // refill serves five lookups instead of four.
+    static void decodeSymbols(const DecodeTable& table, BitReader& reader, char* out, size_t count);
+    template <unsigned MaxLen>
+    static void decodeSymbolsWith(const DecodeTable& table, BitReader& reader, char* out, size_t count);
+
+    // Code length table: symbolCount u16, then (symbol u8, length u8) pairs
+    // for small alphabets or 256 packed 4-bit lengths once that is smaller.
+    static constexpr uint16_t PACKED_TABLE_THRESHOLD = 64;
+    static size_t codeTableSize(uint16_t symbolCount);
+    static void appendCodeLengths(std::string& out, const CodeLengths& lengths, uint16_t symbolCount);
+    static CodeLengths parseCodeLengths(const char* p, const char* end, uint16_t symbolCount);
+
+    // Single-stream file written by compress:
+    //   "HFST" | version u8 | rawSize u64 | bitLen u64 |
+    //   symbolCount u16 | code length table | payload | crc32c u32
+    // bitLen counts the symbol bits only; the CRC-32C of the raw data follows
+    // them in the same bitstream.
+    static constexpr char STREAM_MAGIC[4] = {'H', 'F', 'S', 'T'};
+    static constexpr uint8_t STREAM_VERSION = 2;
+    static constexpr unsigned CHECKSUM_BITS = 32;
+
+    static constexpr size_t STREAM_FIXED_SIZE = sizeof(STREAM_MAGIC) + 1 + 2 * sizeof(uint64_t) + sizeof(uint16_t);
+
+    struct StreamPlan {
+        CodeTable codes;
+        std::string header;
+        uint64_t bitLen = 0;
+    };
+    struct StreamHeader {
+        uint64_t rawSize = 0;
+        uint64_t bitLen = 0;
+        CodeLengths lengths{};
+        size_t size = 0;        // header bytes, magic included
+    };
+
+    // Dictionary stream, written by compressBuffer (and compress) when a
+    // dictionary is set:
+    //   "HFDS" | version u8 | dictionaryId u32 | rawSize varint | payload | crc32c
+    // The code comes from the dictionary, so there is no table and no bitLen.
+    static constexpr char DICT_STREAM_MAGIC[4] = {'H', 'F', 'D', 'S'};
+    static constexpr uint8_t DICT_STREAM_VERSION = 1;
+
+    void compressWithDictionary(const unsigned char* data, size_t size, std::string& out);
+    void decompressWithDictionary(const unsigned char* data, size_t size, std::string& out);
+    // Builds (once per dictionary) the code and decode tables for `dict`.
+    void prepareDictionaryTables(const Dictionary& dict);
+
+    static StreamPlan planStream(const Histogram& freq, uint64_t rawSize);
+    static StreamHeader parseStreamHeader(const char* p, const char* end);
+    // Returns the CRC-32C of `data`, computed slice by slice as it is coded.
+    // The kernel is specialized on the longest code in `codes`, which fixes
+    // how many codes are joined in a register per BitWriter call.
+    static uint32_t encodeSymbols(const CodeTable& codes, const unsigned char* data, size_t size, BitWriter& writer);
+    template <unsigned MaxLen>
+    static uint32_t encodeSymbolsWith(const CodeTable& codes, const unsigned char* data, size_t size,
+                                      BitWriter& writer);
+
+    // Block container written by compressMultiThreaded:
+    //   "HFBK" | version u8 | blockSize u32
+    //   frame* : rawSize u32 | payloadSize u32 | crc32c u32 | bitLen u64 |
+    //            symbolCount u16 | code length table | payload
+    //   rawSize 0 terminator | crc32c u32 of the whole stream
+    //   index  : blockCount u32 | (rawOffset u64, frameOffset u64)*
+    //   footer : indexOffset u64 | "HFIX"
+    // Every frame carries its own code lengths, so blocks encode and decode
+    // independently on separate threads.
+    // RangeReader decodes single frames located through the index.
+    friend class RangeReader;
+    static constexpr char BLOCK_MAGIC[4] = {'H', 'F', 'B', 'K'};
+    static constexpr char INDEX_MAGIC[4] = {'H', 'F', 'I', 'X'};
+    static constexpr uint8_t BLOCK_VERSION = 3;
+    static constexpr uint32_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    struct BlockIndexEntry {
+        uint64_t rawOffset;
+        uint64_t frameOffset;
+    };
+
+    static void encodeBlock(const char* data, size_t size, std::string& frame);
+    static void decodeBlock(const char* frame, size_t frameSize, std::string& out);
+    // Rejects frames whose sizes exceed the container's blockSize or what
+    // rawSize symbols can code to, before allocating for them.
+    static bool readFrame(std::istream& in, uint32_t blockSize, std::string& frame);
+    void compressBlocks(std::istream& in, std::ostream& out, int numThreads);
+    void decompressBlocks(std::istream& in, std::ostream& out, int numThreads);
+
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+    size_t memoryLimit = DEFAULT_MEMORY_LIMIT;
 
-    std::unordered_map<char, std::string> encodingTable;
+    DecodeTable decodeTable;
 
-    void writeBitstream(const std::string& bits, const std::string& outputFile, const std::unordered_map<char, int>& freqMap);
-};
\ No newline at end of file
+    std::shared_ptr<const Dictionary> dictionary;
+    std::shared_ptr<const Dictionary> loadedDictionary;    // last one found by ID
+    std::string dictionaryDir;
+    bool dictTablesReady = false;
+    uint32_t dictTablesId = 0;
+    CodeTable dictCodes{};
+    DecodeTable dictDecodeTable;
+};
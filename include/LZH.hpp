@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+
+class BitReader;
+class BitWriter;
+
+// `-algo lzh`: LZ77 matching followed by Huffman coding of the match/literal
+// stream, the pairing used by deflate. Literals and match lengths share one
+// Huffman alphabet, distances use a second one; both tables are built with
+// Huffman's length-limited construction.
+class LZH {
+public:
+    LZH();
+    ~LZH();
+
+    void compress(const std::string& inputFile, const std::string& outputFile, int numThreads = 1);
+    void decompress(const std::string& inputFile, const std::string& outputFile, int numThreads = 1);
+
+    // In-memory coding; `out` is replaced with the result. Match finder state
+    // and decode tables stay allocated between calls.
+    void compressBuffer(const unsigned char* data, size_t size, std::string& out);
+    void decompressBuffer(const unsigned char* data, size_t size, std::string& out);
+
+    // Upper bound on block buffers held by the streaming block pipeline.
+    void setMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+
+private:
+    // Token stream, in segments of at most SEGMENT_TOKENS tokens:
+    //   litLen lengths | dist lengths | tokens... | END_OF_SEGMENT
+    // Code lengths are 4-bit values; 15 is followed by 5 bits giving a run of
+    // 3-34 unused symbols. Symbols 0-255 are literals, 256 ends a segment and
+    // 257+ are length buckets. A length or distance bucket k < 16 is the value
+    // itself; above that, bucket 16 + 2(n-4) + b covers values whose top bit
+    // is n and next bit is b, followed by n-1 extra bits.
+    static constexpr unsigned MIN_MATCH = 4;
+    static constexpr unsigned MAX_MATCH = MIN_MATCH + 32767;
+    static constexpr unsigned WINDOW_SIZE = 1 << 16;
+    static constexpr unsigned END_OF_SEGMENT = 256;
+    static constexpr unsigned LENGTH_CODES = 38;
+    static constexpr unsigned DIST_CODES = 40;
+    static constexpr unsigned LITLEN_CODES = 257 + LENGTH_CODES;
+    static constexpr unsigned MAX_CODE_LEN = 12;
+    static constexpr size_t SEGMENT_TOKENS = 1 << 16;
+
+    // Buffer layout: "LZHS" | version u8 | rawSize u64 | token stream | crc32c
+    // The CRC-32C of the raw data is the last 32 bits of the bitstream.
+    static constexpr char STREAM_MAGIC[4] = {'L', 'Z', 'H', 'S'};
+    static constexpr uint8_t STREAM_VERSION = 2;
+    static constexpr unsigned CHECKSUM_BITS = 32;
+    static constexpr size_t STREAM_HEADER_SIZE = sizeof(STREAM_MAGIC) + sizeof(uint8_t) + sizeof(uint64_t);
+
+    // File container; blocks are independent so they code in parallel:
+    //   "LZHB" | version u8 | blockSize u32
+    //   frame* : rawSize u32 | payloadSize u32 | crc32c u32 | token stream
+    //   rawSize 0 terminator | crc32c u32 of the whole stream
+    //   index  : blockCount u32 | (rawOffset u64, frameOffset u64)*
+    //   footer : indexOffset u64 | "LZHX"
+    friend class RangeReader;
+    static constexpr char BLOCK_MAGIC[4] = {'L', 'Z', 'H', 'B'};
+    static constexpr char INDEX_MAGIC[4] = {'L', 'Z', 'H', 'X'};
+    static constexpr uint8_t BLOCK_VERSION = 2;
+    static constexpr uint32_t DEFAULT_BLOCK_SIZE = 1 << 20;
+    static constexpr size_t FRAME_HEADER_SIZE = 3 * sizeof(uint32_t);
+
+    // Both return the CRC-32C of the raw data, taken slice by slice while
+    // the match finder or the decoder has it in cache.
+    uint32_t encode(const unsigned char* data, size_t size, BitWriter& writer);
+    uint32_t decode(BitReader& reader, unsigned char* out, size_t rawSize);
+
+    static void encodeBlock(const std::string& block, std::string& frame);
+    static void decodeBlock(const std::string& frame, std::string& block);
+    // Rejects frames larger than the container's blockSize, or whose payload
+    // exceeds what rawSize bytes can code to, before allocating for them.
+    static bool readFrame(std::istream& in, uint32_t blockSize, std::string& frame);
+    static uint64_t maxPayloadSize(uint32_t rawSize);
+
+    struct Workspace;
+    std::unique_ptr<Workspace> work;
+
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+    size_t memoryLimit = DEFAULT_MEMORY_LIMIT;
+};
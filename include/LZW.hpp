@@ -1,10 +1,121 @@
 #pragma once
+#include "Dictionary.hpp"
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+class BitReader;
+class BitWriter;
+
 class LZW{
 public:
+    LZW();
+    ~LZW();
+
     void compress(const std::string& inputFile, const std::string& outputFile);
     void decompress(const std::string& inputFile, const std::string& outputFile);
-};
\ No newline at end of file
+
+    // In-memory coding; `out` is replaced with the result. The phrase table
+    // and reverse dictionary stay allocated between calls, so reusing one
+    // LZW per thread keeps small payloads cheap.
+    void compressBuffer(const unsigned char* data, size_t size, std::string& out);
+    void decompressBuffer(const unsigned char* data, size_t size, std::string& out);
+
+    // Widest code in bits (9-24); the dictionary holds at most 2^bits codes.
+    void setMaxCodeBits(unsigned bits);
+
+    // With a shared dictionary, streams start from its phrases instead of
+    // single bytes and use its code width. Decompression looks up the
+    // dictionary a stream names: this one if the IDs match, otherwise the
+    // file for that ID under the dictionary directory.
+    void setDictionary(std::shared_ptr<const Dictionary> dict);
+    void setDictionaryDir(const std::string& dir) { dictionaryDir = dir; }
+
+    // Phrases worth priming a dictionary with: those the samples match most
+    // often, at most half of the 2^bits codes.
+    static std::vector<Dictionary::Phrase> trainPhrases(const std::vector<std::string>& samples, unsigned bits);
+
+private:
+    // Stream layout: "LZWC" | version u8 | maxCodeBits u8 | codes... | crc32c
+    // Codes are packed MSB-first and grow from 9 bits up to maxCodeBits as
+    // the dictionary fills. CLEAR resets the dictionary, END marks the end
+    // and is followed by 32 bits of CRC-32C over the raw data.
+    static constexpr char MAGIC[4] = {'L', 'Z', 'W', 'C'};
+    static constexpr uint8_t VERSION = 2;
+    static constexpr unsigned CHECKSUM_BITS = 32;
+    static constexpr int CLEAR_CODE = 256;
+    static constexpr int END_CODE = 257;
+    static constexpr int FIRST_CODE = 258;
+    static constexpr unsigned MIN_CODE_BITS = 9;
+    static constexpr unsigned MAX_CODE_BITS = 24;
+    static constexpr unsigned DEFAULT_MAX_CODE_BITS = 16;
+
+    static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 2;
+
+    // Dictionary streams: "LZWD" | version u8 | maxCodeBits u8 | dictionaryId u32 |
+    // codes... | crc32c. Codes from FIRST_CODE on start out as the
+    // dictionary's phrases, and CLEAR returns to that state.
+    static constexpr char DICT_MAGIC[4] = {'L', 'Z', 'W', 'D'};
+    static constexpr size_t DICT_ID_SIZE = sizeof(uint32_t);
+
+    // Width that fits every code below `nextCode`.
+    static unsigned codeWidth(int nextCode);
+
+    std::string encodeHeader() const;
+    // Validates a HEADER_SIZE-byte header and returns its code width. A
+    // dictionary stream's header continues with DICT_ID_SIZE bytes of ID.
+    static unsigned parseHeader(const char* header);
+    static bool isDictionaryStream(const char* header);
+    // The dictionary for a stream's ID, checked against the stream's width.
+    const Dictionary& dictionaryFor(const char* idBytes, unsigned bits);
+    static void checkDictionary(const Dictionary& dict);
+
+    struct EncodeStats {
+        uint64_t inSize = 0;
+        uint64_t outBits = 0;
+        uint64_t resets = 0;
+        uint64_t peakCodes = 0;     // most codes in use before a CLEAR or the end
+    };
+
+    // Shared kernels: `nextChunk(const unsigned char*&)` yields input until
+    // it returns 0; `makeRoom(outPos, need)` must leave `need` bytes free in
+    // the decode buffer at `outPos` (flushing or growing it). Both check the
+    // CRC of the data chunk by chunk as it passes through.
+    template <typename NextChunk>
+    EncodeStats encode(NextChunk nextChunk, BitWriter& writer);
+    template <typename MakeRoom>
+    uint64_t decode(BitReader& reader, unsigned bits, const Dictionary* dict, std::string& buffer, size_t& outPos,
+                    MakeRoom makeRoom);
+
+    // The kernels behind encode/decode, specialized on the code width. The
+    // preset widths (12 and 16, the usual choices) get a constant dictionary
+    // size and phrase table hash; MaxBits = 0 takes `bits` at run time.
+    template <unsigned MaxBits, typename NextChunk>
+    EncodeStats encodeWith(NextChunk& nextChunk, BitWriter& writer, unsigned bits, int base);
+    template <unsigned MaxBits, typename MakeRoom>
+    uint64_t decodeWith(BitReader& reader, unsigned bits, int base, std::string& buffer, size_t& outPos,
+                        MakeRoom& makeRoom);
+
+    class PhraseTable;
+    std::unique_ptr<PhraseTable> phrases;
+    // ID of the dictionary whose phrases are in `phrases` / the decode tables.
+    bool encodePrimed = false;
+    uint32_t encodePrimedId = 0;
+    bool decodePrimed = false;
+    uint32_t decodePrimedId = 0;
+
+    // Reverse dictionary as flat arrays: every code is (prefix code, last
+    // byte) plus its length and first byte, so phrases are never copied.
+    std::vector<uint32_t> prefix;
+    std::vector<uint32_t> length;
+    std::vector<unsigned char> lastByte;
+    std::vector<unsigned char> firstByte;
+    void prepareDecodeTables(int maxCode);
+    void primeDecodeTables(const Dictionary& dict);
+
+    unsigned maxCodeBits = DEFAULT_MAX_CODE_BITS;
+    std::shared_ptr<const Dictionary> dictionary;
+    std::shared_ptr<const Dictionary> loadedDictionary;    // last one found by ID
+    std::string dictionaryDir;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bounded reader -> workers -> ordered writer pipeline. At most `window`
+// blocks are in flight at any time, so memory stays near
+// window * (input block + output block) no matter how long the stream is.
+class BlockPipeline {
+public:
+    // Fills `block` with the next input block; returns false at end of stream.
+    using ReadFn = std::function<bool(std::string& block)>;
+    // Transforms one block; called concurrently from worker threads.
+    using WorkFn = std::function<void(const std::string& input, std::string& output)>;
+    // Consumes finished blocks strictly in input order.
+    using WriteFn = std::function<void(const std::string& output)>;
+
+    BlockPipeline(int numThreads, size_t window);
+
+    // Runs until the reader reports end of stream. The first exception thrown
+    // by any stage stops the pipeline and is rethrown here.
+    void run(const ReadFn& read, const WorkFn& work, const WriteFn& write);
+
+    // Largest window whose blocks fit in `memoryLimit`, never below one block
+    // and never more than a few blocks per worker.
+    static size_t windowForMemory(size_t memoryLimit, size_t bytesPerBlock, int numThreads);
+
+    // (rawOffset, frameOffset) of each block, as written to a container index.
+    using BlockIndex = std::vector<std::pair<uint64_t, uint64_t>>;
+
+    // Reads the index and footer that end a block container
+    //   blockCount u32 | (rawOffset u64, frameOffset u64)* | indexOffset u64 | magic
+    // and throws unless they describe exactly the blocks just decoded, so a
+    // sequential decode also vouches for later random access.
+    static void checkIndex(std::istream& in, const BlockIndex& blocks, uint64_t indexOffset, const char* indexMagic);
+
+private:
+    int numThreads;
+    size_t window;
+};
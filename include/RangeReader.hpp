@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Random access into the indexed block containers: Huffman blocks
+// (compressMultiThreaded), lzh and auto. The trailing block index maps
+// uncompressed offsets to frames, so a read decodes only the blocks that
+// overlap the requested range. Single-stream Huffman (HFST) and LZW files
+// have no index and are rejected.
+class RangeReader {
+public:
+    explicit RangeReader(const std::string& inputFile);
+
+    // Uncompressed size of the whole file.
+    uint64_t size() const { return rawSize; }
+
+    // Replaces `out` with bytes [offset, offset + length), clipped to size().
+    void read(uint64_t offset, uint64_t length, std::string& out);
+    std::string read(uint64_t offset, uint64_t length) {
+        std::string out;
+        read(offset, length, out);
+        return out;
+    }
+
+    size_t blockCount() const { return index.size(); }
+    // Blocks decoded so far; repeated reads inside one block decode it once.
+    uint64_t blocksDecoded() const { return decoded; }
+
+private:
+    enum class Format { HuffmanBlocks, Adaptive, LZH };
+
+    struct Block {
+        uint64_t rawOffset;
+        uint64_t frameOffset;
+    };
+
+    void loadIndex(const std::string& inputFile);
+    const std::string& decodeBlock(size_t i);
+
+    std::ifstream file;
+    Format format = Format::HuffmanBlocks;
+    std::vector<Block> index;
+    uint64_t rawSize = 0;
+    uint32_t blockSize = 0;     // from the container header, bounds each frame
+    uint64_t decoded = 0;
+
+    std::string frame;
+    std::string block;
+    size_t cachedBlock = SIZE_MAX;
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Per-stage profiling counters for the hot paths. Every thread records into
+// its own slot, so instrumented code never shares a cache line or takes a
+// lock; slots are only merged when a report is written.
+//
+// Built in when FC_STATS is defined (CMake option FILECOMPRESSOR_STATS, on by
+// default); otherwise FC_STAGE, FC_COUNT and FC_PEAK compile to nothing. Even
+// when built in, nothing is recorded until setEnabled(true), and then only at
+// block or buffer granularity: a stage costs two clock reads.
+namespace Stats {
+    enum class Stage {
+        Read,           // input I/O
+        Histogram,      // byte counting
+        Table,          // Huffman tree, code and decode table construction
+        Encode,
+        Decode,
+        Write,          // output I/O
+        ReaderStall,    // pipeline reader waiting for a free slot (window full)
+        WorkerIdle,     // pipeline worker waiting for a block to code
+        WriterStall,    // pipeline writer waiting for the next block in order
+        Count
+    };
+
+    enum class Counter {
+        BytesIn,
+        BytesOut,
+        Blocks,
+        LzwResets,          // CLEAR codes emitted or seen
+        LzwPeakCodes,       // most dictionary codes in use at once (peak)
+        LzwCodeCapacity,    // 2^maxCodeBits (peak)
+        Count
+    };
+
+    constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::Count);
+    constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+    struct ThreadRecord {
+        const char* role = "thread";
+        uint64_t stageNanos[STAGE_COUNT] = {};
+        uint64_t stageCalls[STAGE_COUNT] = {};
+        uint64_t counters[COUNTER_COUNT] = {};
+        // Innermost open stage; nested stages pause it, so stage times are
+        // exclusive and add up to at most the thread's run time.
+        int activeStage = -1;
+        std::chrono::steady_clock::time_point activeSince;
+    };
+
+    // False when the library was built without FC_STATS.
+    bool compiledIn();
+
+    inline std::atomic<bool>& enabledFlag() {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+    inline bool enabled() { return enabledFlag().load(std::memory_order_relaxed); }
+    // Enabling also clears everything recorded so far.
+    void setEnabled(bool on);
+    // Zeroes all slots and restarts the wall clock; call while no coding runs.
+    void reset();
+
+    // The calling thread's slot, created on first use.
+    ThreadRecord& local();
+    // Labels the calling thread in reports ("main", "pipeline-worker", ...).
+    void setThreadRole(const char* role);
+
+    inline void add(Counter counter, uint64_t n) {
+        if (enabled()) local().counters[static_cast<size_t>(counter)] += n;
+    }
+    inline void peak(Counter counter, uint64_t value) {
+        if (!enabled()) return;
+        uint64_t& slot = local().counters[static_cast<size_t>(counter)];
+        if (value > slot) slot = value;
+    }
+
+    class ScopedStage {
+    public:
+        explicit ScopedStage(Stage stage) {
+            if (!enabled()) return;
+            record = &local();
+            auto now = std::chrono::steady_clock::now();
+            if (record->activeStage >= 0) charge(*record, now);
+            previous = record->activeStage;
+            record->activeStage = static_cast<int>(stage);
+            record->activeSince = now;
+            record->stageCalls[static_cast<size_t>(stage)]++;
+        }
+        ~ScopedStage() {
+            if (!record) return;
+            auto now = std::chrono::steady_clock::now();
+            charge(*record, now);
+            record->activeStage = previous;
+            record->activeSince = now;
+        }
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+    private:
+        static void charge(ThreadRecord& r, std::chrono::steady_clock::time_point now) {
+            r.stageNanos[r.activeStage] += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - r.activeSince).count());
+        }
+
+        ThreadRecord* record = nullptr;
+        int previous = -1;
+    };
+
+    // Merged report: totals per stage and counter, then one entry per thread
+    // that recorded anything.
+    void writeJson(std::ostream& out);
+    // Human-readable summary of the same data, for --verbose.
+    void writeSummary(std::ostream& out);
+}
+
+#define FC_STATS_CONCAT2(a, b) a##b
+#define FC_STATS_CONCAT(a, b) FC_STATS_CONCAT2(a, b)
+
+#ifdef FC_STATS
+#define FC_STAGE(stage) Stats::ScopedStage FC_STATS_CONCAT(fcStage, __LINE__)(Stats::Stage::stage)
+#define FC_COUNT(counter, n) Stats::add(Stats::Counter::counter, (n))
+#define FC_PEAK(counter, n) Stats::peak(Stats::Counter::counter, (n))
+#else
+// `n` is named but not evaluated, so values computed only for the counters
+// do not trigger unused warnings.
+#define FC_STAGE(stage) ((void)0)
+#define FC_COUNT(counter, n) ((void)sizeof(n))
+#define FC_PEAK(counter, n) ((void)sizeof(n))
+#endif
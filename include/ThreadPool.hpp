@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for many independent tasks of uneven size. Each worker
+// owns a deque: it pops its newest task from the back, and when its own deque
+// is empty it steals the oldest task from the front of another's. Tasks
+// submitted from inside a task go to the submitting worker's deque.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished. The first exception
+    // thrown by a task is rethrown here; tasks still queued after a failure
+    // are dropped without running.
+    void wait();
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t self);
+    bool take(size_t self, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;       // tasks queued or stopping
+    std::condition_variable finished;   // pending dropped to zero
+    std::atomic<long> queued{0};        // tasks in some deque (briefly -1 while a push is counted)
+    std::atomic<size_t> pending{0};     // submitted and not yet finished
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr failure;
+    bool stopping = false;
+};
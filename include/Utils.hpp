@@ -2,6 +2,13 @@
 #include <string>
 #include <filesystem>
 #include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 namespace Utils {
     inline long long getFileSize(const std::string& path) {
@@ -23,4 +30,35 @@ namespace Utils {
     private:
         std::chrono::high_resolution_clock::time_point start;
     };
-}
\ No newline at end of file
+
+    // "-" as a path selects stdin/stdout so the tool can sit in a shell pipeline.
+    inline bool isStdio(const std::string& path) { return path == "-"; }
+
+    // Set once compressed or restored data is written to stdout.
+    inline bool& stdoutCarriesData() {
+        static bool flag = false;
+        return flag;
+    }
+
+    // Library calls stay silent unless the embedding program (the CLI)
+    // turns reports on.
+    inline bool& reportsEnabled() {
+        static bool flag = false;
+        return flag;
+    }
+
+    // Status and report output; moves to stderr when stdout carries data.
+    inline std::ostream& log() {
+        static std::ostream silent(nullptr);
+        if (!reportsEnabled()) return silent;
+        return stdoutCarriesData() ? std::cerr : std::cout;
+    }
+
+    inline void setBinaryMode(std::FILE* f) {
+#ifdef _WIN32
+        _setmode(_fileno(f), _O_BINARY);
+#else
+        (void)f;
+#endif
+    }
+}
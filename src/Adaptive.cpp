@@ -0,0 +1,360 @@
+#include "Adaptive.hpp"
+#include "Checksum.hpp"
+#include "FileIO.hpp"
+#include "Huffman.hpp"
+#include "LZW.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // A codec only runs when its estimate beats the raw size by this factor.
+    constexpr double STORE_THRESHOLD = 0.97;
+    // When the runner-up is estimated within this factor of the best, both
+    // are encoded and the smaller result is kept.
+    constexpr double TRY_BOTH_MARGIN = 1.10;
+    // LZW is estimated by compressing a few slices spread over the block.
+    constexpr size_t LZW_SAMPLE_SLICE = 16 << 10;
+    constexpr size_t LZW_SAMPLE_SLICES = 3;
+    // Huffman stream header plus a packed code table.
+    constexpr double HUFFMAN_OVERHEAD = 160;
+
+    // Per-thread codec contexts, so workers reuse tables across blocks.
+    struct Contexts {
+        Huffman huffman;
+        LZW lzw;
+        std::string sample;
+        std::string candidates[2];
+    };
+
+    Contexts& threadContexts() {
+        thread_local Contexts contexts;
+        return contexts;
+    }
+
+    template <typename T>
+    void appendField(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Huffman spends at least the entropy and never less than one bit per
+    // symbol.
+    double huffmanEstimate(const Huffman::Histogram& freq, size_t size) {
+        double bits = 0;
+        for (uint64_t f : freq) {
+            if (f) bits -= static_cast<double>(f) * std::log2(static_cast<double>(f) / size);
+        }
+        return std::max(bits, static_cast<double>(size)) / 8 + HUFFMAN_OVERHEAD;
+    }
+
+    // Leaves the LZW sample's encoding in candidates[0]. Small blocks are
+    // compressed whole, so `exact` is set and that encoding is the real one.
+    double lzwEstimate(Contexts& ctx, const unsigned char* data, size_t size, bool& exact) {
+        exact = size <= LZW_SAMPLE_SLICE * LZW_SAMPLE_SLICES;
+        if (exact) {
+            ctx.lzw.compressBuffer(data, size, ctx.candidates[0]);
+            return static_cast<double>(ctx.candidates[0].size());
+        }
+        ctx.sample.clear();
+        size_t stride = (size - LZW_SAMPLE_SLICE) / (LZW_SAMPLE_SLICES - 1);
+        for (size_t i = 0; i < LZW_SAMPLE_SLICES; ++i) {
+            ctx.sample.append(reinterpret_cast<const char*>(data) + i * stride, LZW_SAMPLE_SLICE);
+        }
+        ctx.lzw.compressBuffer(reinterpret_cast<const unsigned char*>(ctx.sample.data()), ctx.sample.size(),
+                               ctx.candidates[0]);
+        return static_cast<double>(ctx.candidates[0].size()) * size / ctx.sample.size();
+    }
+
+    void encodeWith(Adaptive::Method method, Contexts& ctx, const unsigned char* data, size_t size,
+                    std::string& out) {
+        if (method == Adaptive::Method::Huffman) {
+            ctx.huffman.compressBuffer(data, size, out);
+        } else {
+            ctx.lzw.compressBuffer(data, size, out);
+        }
+    }
+
+    const char* methodName(Adaptive::Method method) {
+        switch (method) {
+            case Adaptive::Method::Stored: return "stored";
+            case Adaptive::Method::Huffman: return "huffman";
+            case Adaptive::Method::LZW: return "lzw";
+        }
+        return "unknown";
+    }
+
+    constexpr size_t PAYLOAD_SIZE_OFFSET = sizeof(uint32_t) + sizeof(uint8_t);
+    constexpr size_t CRC_OFFSET = PAYLOAD_SIZE_OFFSET + sizeof(uint32_t);
+
+    // Raw size and checksum of a frame, for chaining the stream checksum.
+    std::pair<uint32_t, uint32_t> frameChecksum(const std::string& frame) {
+        uint32_t rawSize, crc;
+        std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+        std::memcpy(&crc, frame.data() + CRC_OFFSET, sizeof(crc));
+        return {rawSize, crc};
+    }
+}
+
+void Adaptive::encodeBlock(const std::string& block, std::string& frame) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(block.data());
+    size_t size = block.size();
+    Contexts& ctx = threadContexts();
+
+    double huffman = huffmanEstimate(Huffman::buildFrequencyTable(data, size), size);
+    bool lzwExact;
+    double lzw = lzwEstimate(ctx, data, size, lzwExact);
+    Method first = huffman <= lzw ? Method::Huffman : Method::LZW;
+    Method second = first == Method::Huffman ? Method::LZW : Method::Huffman;
+    double best = std::min(huffman, lzw);
+    double runnerUp = std::max(huffman, lzw);
+
+    Method method = Method::Stored;
+    const std::string* payload = &block;
+    if (best < size * STORE_THRESHOLD) {
+        // An exact LZW estimate is already the encoding; move it to the
+        // candidate slot LZW would be written to instead of redoing it.
+        if (lzwExact && second == Method::LZW) std::swap(ctx.candidates[0], ctx.candidates[1]);
+        if (!(lzwExact && first == Method::LZW)) encodeWith(first, ctx, data, size, ctx.candidates[0]);
+        method = first;
+        payload = &ctx.candidates[0];
+        if (runnerUp <= best * TRY_BOTH_MARGIN) {
+            if (!(lzwExact && second == Method::LZW)) encodeWith(second, ctx, data, size, ctx.candidates[1]);
+            if (ctx.candidates[1].size() < payload->size()) {
+                method = second;
+                payload = &ctx.candidates[1];
+            }
+        }
+        // Estimates can be wrong; never let a block grow.
+        if (payload->size() >= size) {
+            method = Method::Stored;
+            payload = &block;
+        }
+    }
+
+    frame.clear();
+    frame.reserve(FRAME_HEADER_SIZE + payload->size());
+    appendField<uint32_t>(frame, static_cast<uint32_t>(size));
+    appendField<uint8_t>(frame, static_cast<uint8_t>(method));
+    appendField<uint32_t>(frame, static_cast<uint32_t>(payload->size()));
+    appendField<uint32_t>(frame, Crc32c::compute(data, size));
+    frame += *payload;
+    FC_COUNT(BytesIn, size);
+    FC_COUNT(BytesOut, frame.size());
+    FC_COUNT(Blocks, 1);
+}
+
+void Adaptive::decodeBlock(const std::string& frame, std::string& block) {
+    if (frame.size() < FRAME_HEADER_SIZE) {
+        throw std::runtime_error("Corrupt adaptive block: truncated frame");
+    }
+    uint32_t rawSize, payloadSize, crc;
+    uint8_t method;
+    std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+    std::memcpy(&method, frame.data() + sizeof(rawSize), sizeof(method));
+    std::memcpy(&payloadSize, frame.data() + PAYLOAD_SIZE_OFFSET, sizeof(payloadSize));
+    std::memcpy(&crc, frame.data() + CRC_OFFSET, sizeof(crc));
+    if (frame.size() - FRAME_HEADER_SIZE != payloadSize) {
+        throw std::runtime_error("Corrupt adaptive block: bad frame header");
+    }
+
+    const unsigned char* payload = reinterpret_cast<const unsigned char*>(frame.data()) + FRAME_HEADER_SIZE;
+    Contexts& ctx = threadContexts();
+    switch (static_cast<Method>(method)) {
+        case Method::Stored:
+            block.assign(reinterpret_cast<const char*>(payload), payloadSize);
+            break;
+        case Method::Huffman:
+            ctx.huffman.decompressBuffer(payload, payloadSize, block);
+            break;
+        case Method::LZW:
+            ctx.lzw.decompressBuffer(payload, payloadSize, block);
+            break;
+        default:
+            throw std::runtime_error("Corrupt adaptive block: unknown method");
+    }
+    if (block.size() != rawSize) {
+        throw std::runtime_error("Corrupt adaptive block: size mismatch");
+    }
+    if (Crc32c::compute(block.data(), block.size()) != crc) {
+        throw std::runtime_error("Adaptive block checksum mismatch");
+    }
+    FC_COUNT(BytesIn, frame.size());
+    FC_COUNT(BytesOut, block.size());
+    FC_COUNT(Blocks, 1);
+}
+
+bool Adaptive::readFrame(std::istream& in, uint32_t blockSize, std::string& frame) {
+    frame.resize(FRAME_HEADER_SIZE);
+    in.read(&frame[0], sizeof(uint32_t));
+    if (!in) {
+        throw std::runtime_error("Truncated adaptive block container");
+    }
+    uint32_t rawSize;
+    std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+    if (rawSize == 0) return false;
+    if (rawSize > blockSize) {
+        throw std::runtime_error("Corrupt adaptive block: larger than the container's block size");
+    }
+
+    in.read(&frame[sizeof(uint32_t)], FRAME_HEADER_SIZE - sizeof(uint32_t));
+    uint32_t payloadSize;
+    std::memcpy(&payloadSize, frame.data() + PAYLOAD_SIZE_OFFSET, sizeof(payloadSize));
+    if (!in) {
+        throw std::runtime_error("Truncated adaptive block container");
+    }
+    // encodeBlock stores any block that coding would not shrink.
+    if (payloadSize > rawSize) {
+        throw std::runtime_error("Corrupt adaptive block: payload larger than the block");
+    }
+    frame.resize(FRAME_HEADER_SIZE + payloadSize);
+    in.read(&frame[FRAME_HEADER_SIZE], payloadSize);
+    if (!in) {
+        throw std::runtime_error("Truncated adaptive block container");
+    }
+    return true;
+}
+
+void Adaptive::compress(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    using namespace std::chrono;
+    auto start = high_resolution_clock::now();
+
+    InputFile input(inputFile, InputFile::Access::Streamed);
+    OutputFile output(outputFile);
+    std::istream& in = input.stream();
+    std::ostream& out = output.stream();
+
+    out.write(BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    out.write(reinterpret_cast<const char*>(&BLOCK_VERSION), sizeof(BLOCK_VERSION));
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    out.write(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
+
+    std::vector<std::pair<uint64_t, uint64_t>> index;   // (rawOffset, frameOffset)
+    uint64_t frameOffset = sizeof(BLOCK_MAGIC) + sizeof(BLOCK_VERSION) + sizeof(blockSize);
+    uint64_t rawOffset = 0;
+    uint64_t methodCounts[3] = {};
+    uint32_t streamCrc = Crc32c().value();
+
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& block) {
+            FC_STAGE(Read);
+            block.resize(blockSize);
+            in.read(&block[0], blockSize);
+            block.resize(static_cast<size_t>(in.gcount()));
+            if (in.bad()) {
+                throw std::runtime_error("Could not read input");
+            }
+            return !block.empty();
+        },
+        encodeBlock,
+        [&](const std::string& frame) {
+            FC_STAGE(Write);
+            uint32_t rawSize;
+            std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+            methodCounts[static_cast<uint8_t>(frame[sizeof(rawSize)])]++;
+            streamCrc = Crc32c::combine(streamCrc, frameChecksum(frame).second, rawSize);
+            index.emplace_back(rawOffset, frameOffset);
+            out.write(frame.data(), frame.size());
+            frameOffset += frame.size();
+            rawOffset += rawSize;
+        });
+
+    uint32_t terminator = 0;
+    out.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator));
+    out.write(reinterpret_cast<const char*>(&streamCrc), sizeof(streamCrc));
+
+    uint64_t indexOffset = frameOffset + sizeof(terminator) + sizeof(streamCrc);
+    uint32_t indexCount = static_cast<uint32_t>(index.size());
+    out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+    for (auto& entry : index) {
+        out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+        out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+    }
+    out.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    output.close();
+
+    double timeTaken = duration<double>(high_resolution_clock::now() - start).count();
+    uint64_t outSize = indexOffset + sizeof(indexCount) + index.size() * 2 * sizeof(uint64_t)
+                       + sizeof(indexOffset) + sizeof(INDEX_MAGIC);
+    double ratio = rawOffset ? (1.0 - (double)outSize / rawOffset) * 100.0 : 0.0;
+    double throughput = timeTaken > 0 ? (rawOffset / (1024.0 * 1024.0)) / timeTaken : 0.0;
+
+    Utils::log() << "✅ [Auto] Compression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << index.size() << " (";
+    for (uint8_t m = 0; m < 3; ++m) {
+        Utils::log() << (m ? ", " : "") << methodName(static_cast<Method>(m)) << " " << methodCounts[m];
+    }
+    Utils::log() << ") | Input: " << rawOffset << " bytes | Output: " << outSize << " bytes | Ratio: " << ratio
+                 << "% | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
+}
+
+void Adaptive::decompress(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    InputFile input(inputFile, InputFile::Access::Streamed);
+    std::istream& in = input.stream();
+
+    char magic[4] = {};
+    uint8_t version = 0;
+    uint32_t blockSize = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+    if (!in || std::memcmp(magic, BLOCK_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an adaptive block container: " + inputFile);
+    }
+    if (version != BLOCK_VERSION) {
+        throw std::runtime_error("Unsupported adaptive block container version: " + inputFile);
+    }
+
+    OutputFile output(outputFile);
+    std::ostream& out = output.stream();
+    uint64_t outSize = 0;
+    uint64_t blockCount = 0;
+    uint32_t streamCrc = Crc32c().value();
+    BlockPipeline::BlockIndex index;
+    uint64_t rawOffset = 0;
+    uint64_t frameOffset = sizeof(BLOCK_MAGIC) + sizeof(version) + sizeof(blockSize);
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& frame) {
+            FC_STAGE(Read);
+            if (!readFrame(in, blockSize, frame)) return false;
+            auto checksum = frameChecksum(frame);
+            streamCrc = Crc32c::combine(streamCrc, checksum.second, checksum.first);
+            index.emplace_back(rawOffset, frameOffset);
+            rawOffset += checksum.first;
+            frameOffset += frame.size();
+            return true;
+        },
+        decodeBlock,
+        [&](const std::string& block) {
+            FC_STAGE(Write);
+            out.write(block.data(), block.size());
+            outSize += block.size();
+            blockCount++;
+        });
+
+    uint32_t storedCrc = 0;
+    in.read(reinterpret_cast<char*>(&storedCrc), sizeof(storedCrc));
+    if (!in || storedCrc != streamCrc) {
+        throw std::runtime_error("Adaptive stream checksum mismatch: " + inputFile);
+    }
+    BlockPipeline::checkIndex(in, index, frameOffset + 2 * sizeof(uint32_t), INDEX_MAGIC);
+    output.close();
+
+    double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    double throughput = timeTaken > 0 ? (outSize / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Auto] Decompression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << blockCount << " | Output: " << outSize
+                 << " bytes | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
+}
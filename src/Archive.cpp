@@ -0,0 +1,432 @@
+#include "Archive.hpp"
+#include "Checksum.hpp"
+#include "Codec.hpp"
+#include "FileIO.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char* codecName(Archive::Method method) {
+        switch (method) {
+            case Archive::Method::Huffman: return "huffman";
+            case Archive::Method::LZW: return "lzw";
+            case Archive::Method::LZH: return "lzh";
+            default: return "stored";
+        }
+    }
+
+    // One codec per method per worker thread, reused across chunks.
+    Codec& threadCodec(Archive::Method method) {
+        thread_local std::array<std::unique_ptr<Codec>, 4> codecs;
+        auto& codec = codecs[static_cast<size_t>(method)];
+        if (!codec) codec = Codec::create(codecName(method));
+        return *codec;
+    }
+
+    // The archive, opened once per worker thread during extraction.
+    std::ifstream& threadArchive(const std::string& path) {
+        thread_local std::ifstream file;
+        thread_local std::string openPath;
+        if (openPath != path) {
+            file.close();
+            file.clear();
+            file.open(path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not open archive: " + path);
+            }
+            openPath = path;
+        }
+        return file;
+    }
+
+    template <typename T>
+    void writeField(std::ostream& out, T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readField(std::istream& in) {
+        T value{};
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (!in) {
+            throw std::runtime_error("Truncated archive index");
+        }
+        return value;
+    }
+
+    // Archive names must stay inside the extraction directory.
+    bool isSafeName(const std::string& name) {
+        fs::path path(name);
+        if (name.empty() || path.is_absolute() || path.has_root_name()) return false;
+        for (const auto& part : path) {
+            if (part == "..") return false;
+        }
+        return true;
+    }
+}
+
+void Archive::setCodec(const std::string& name) {
+    if (name == "huffman") method = Method::Huffman;
+    else if (name == "lzw") method = Method::LZW;
+    else if (name == "lzh") method = Method::LZH;
+    else throw std::runtime_error("Unsupported archive codec: " + name);
+}
+
+std::string Archive::archiveName(const std::string& path) {
+    // Like tar: drop the root and any leading "..", keep the rest as given.
+    fs::path normal = fs::path(path).lexically_normal().relative_path();
+    fs::path name;
+    bool leading = true;
+    for (const auto& part : normal) {
+        if (leading && (part == ".." || part == ".")) continue;
+        leading = false;
+        name /= part;
+    }
+    return name.generic_string();
+}
+
+std::vector<Archive::Entry> Archive::collectEntries(const std::vector<std::string>& inputs) {
+    std::vector<Entry> entries;
+    auto add = [&](const fs::path& source) {
+        Entry entry;
+        entry.source = source.string();
+        entry.path = archiveName(entry.source);
+        entry.rawSize = fs::file_size(source);
+        if (entry.path.empty()) {
+            throw std::runtime_error("Cannot name archive entry for: " + entry.source);
+        }
+        entries.push_back(std::move(entry));
+    };
+
+    for (const std::string& input : inputs) {
+        fs::path path(input);
+        if (fs::is_directory(path)) {
+            std::vector<fs::path> files;
+            for (const auto& item : fs::recursive_directory_iterator(path)) {
+                if (item.is_regular_file()) files.push_back(item.path());
+            }
+            // Directory order is arbitrary; sorting keeps archives reproducible.
+            std::sort(files.begin(), files.end());
+            for (const auto& file : files) add(file);
+        } else if (fs::is_regular_file(path)) {
+            add(path);
+        } else {
+            throw std::runtime_error("Not a file or directory: " + input);
+        }
+    }
+    return entries;
+}
+
+std::vector<std::string> Archive::readFileList(const std::string& listFile) {
+    std::ifstream file;
+    std::istream* in = &std::cin;
+    if (!Utils::isStdio(listFile)) {
+        file.open(listFile);
+        if (!file) {
+            throw std::runtime_error("Could not open file list: " + listFile);
+        }
+        in = &file;
+    }
+    std::vector<std::string> paths;
+    std::string line;
+    while (std::getline(*in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) paths.push_back(line);
+    }
+    return paths;
+}
+
+void Archive::create(const std::string& outputFile, const std::vector<std::string>& inputs, int numThreads) {
+    using namespace std::chrono;
+    auto start = high_resolution_clock::now();
+
+    std::vector<Entry> entries = collectEntries(inputs);
+
+    OutputFile output(outputFile);
+    std::ostream& out = output.stream();
+    out.write(MAGIC, sizeof(MAGIC));
+    writeField<uint8_t>(out, VERSION);
+
+    std::mutex writeMutex;
+    uint64_t offset = sizeof(MAGIC) + sizeof(VERSION);
+    uint64_t rawTotal = 0;
+    size_t chunkTotal = 0;
+    size_t storedTotal = 0;
+
+    {
+        ThreadPool pool(numThreads);
+        for (Entry& entry : entries) {
+            entry.chunks.resize(static_cast<size_t>((entry.rawSize + CHUNK_SIZE - 1) / CHUNK_SIZE));
+            rawTotal += entry.rawSize;
+            chunkTotal += entry.chunks.size();
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                pool.submit([&, c, entryPtr = &entry]() {
+                    const Entry& e = *entryPtr;
+                    Chunk& chunk = entryPtr->chunks[c];
+                    uint64_t begin = c * uint64_t(CHUNK_SIZE);
+                    size_t size = static_cast<size_t>(std::min<uint64_t>(CHUNK_SIZE, e.rawSize - begin));
+
+                    thread_local std::string raw, packed;
+                    {
+                        FC_STAGE(Read);
+                        std::ifstream file(e.source, std::ios::binary);
+                        raw.resize(size);
+                        file.seekg(static_cast<std::streamoff>(begin));
+                        file.read(&raw[0], size);
+                        if (static_cast<size_t>(file.gcount()) != size) {
+                            throw std::runtime_error("Could not read (or file changed): " + e.source);
+                        }
+                    }
+
+                    chunk.method = method;
+                    threadCodec(method).compress(raw, packed);
+                    const std::string* payload = &packed;
+                    if (packed.size() >= raw.size()) {
+                        chunk.method = Method::Stored;
+                        payload = &raw;
+                    }
+                    chunk.rawSize = static_cast<uint32_t>(size);
+                    chunk.crc = Crc32c::compute(raw.data(), raw.size());
+                    chunk.payloadSize = static_cast<uint32_t>(payload->size());
+
+                    FC_COUNT(Blocks, 1);
+                    FC_STAGE(Write);
+                    std::lock_guard<std::mutex> lock(writeMutex);
+                    chunk.offset = offset;
+                    out.write(payload->data(), payload->size());
+                    offset += payload->size();
+                    if (chunk.method == Method::Stored) storedTotal++;
+                });
+            }
+        }
+        pool.wait();
+    }
+
+    uint64_t indexOffset = offset;
+    uint64_t outSize = indexOffset + sizeof(uint32_t) + sizeof(indexOffset) + sizeof(INDEX_MAGIC);
+    writeField<uint32_t>(out, static_cast<uint32_t>(entries.size()));
+    for (const Entry& entry : entries) {
+        if (entry.path.size() > UINT16_MAX) {
+            throw std::runtime_error("Path too long for archive: " + entry.path);
+        }
+        writeField<uint16_t>(out, static_cast<uint16_t>(entry.path.size()));
+        out.write(entry.path.data(), entry.path.size());
+        writeField<uint64_t>(out, entry.rawSize);
+        writeField<uint32_t>(out, static_cast<uint32_t>(entry.chunks.size()));
+        outSize += sizeof(uint16_t) + entry.path.size() + sizeof(uint64_t) + sizeof(uint32_t)
+                   + entry.chunks.size() * (sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(uint64_t));
+        for (const Chunk& chunk : entry.chunks) {
+            writeField<uint8_t>(out, static_cast<uint8_t>(chunk.method));
+            writeField<uint32_t>(out, chunk.rawSize);
+            writeField<uint64_t>(out, chunk.offset);
+            writeField<uint32_t>(out, chunk.payloadSize);
+            writeField<uint32_t>(out, chunk.crc);
+        }
+    }
+    writeField<uint64_t>(out, indexOffset);
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    output.close();
+
+    double timeTaken = duration<double>(high_resolution_clock::now() - start).count();
+    double ratio = rawTotal ? (1.0 - (double)outSize / rawTotal) * 100.0 : 0.0;
+    double throughput = timeTaken > 0 ? (rawTotal / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Archive] Created with " << codecName(method) << ".\n";
+    Utils::log() << "Threads: " << numThreads << " | Files: " << entries.size() << " | Chunks: " << chunkTotal
+                 << " (" << storedTotal << " stored) | Input: " << rawTotal << " bytes | Output: " << outSize
+                 << " bytes | Ratio: " << ratio << "% | Time: " << timeTaken << "s | Throughput: " << throughput
+                 << " MB/s\n";
+}
+
+std::vector<Archive::Entry> Archive::readIndex(std::istream& in, const std::string& archiveFile) {
+    char magic[4] = {};
+    uint8_t version = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!in || std::memcmp(magic, MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an archive: " + archiveFile);
+    }
+    if (version != VERSION) {
+        throw std::runtime_error("Unsupported archive version: " + archiveFile);
+    }
+
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    uint64_t footerSize = sizeof(uint64_t) + sizeof(INDEX_MAGIC);
+    if (fileSize < sizeof(MAGIC) + sizeof(VERSION) + footerSize) {
+        throw std::runtime_error("Truncated archive: " + archiveFile);
+    }
+    in.seekg(static_cast<std::streamoff>(fileSize - footerSize));
+    uint64_t indexOffset = readField<uint64_t>(in);
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 || indexOffset > fileSize - footerSize) {
+        throw std::runtime_error("Archive index missing or damaged: " + archiveFile);
+    }
+
+    in.seekg(static_cast<std::streamoff>(indexOffset));
+    uint32_t entryCount = readField<uint32_t>(in);
+    std::vector<Entry> entries;
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        Entry entry;
+        entry.path.resize(readField<uint16_t>(in));
+        in.read(&entry.path[0], entry.path.size());
+        entry.rawSize = readField<uint64_t>(in);
+        uint32_t chunkCount = readField<uint32_t>(in);
+        if (!isSafeName(entry.path)) {
+            throw std::runtime_error("Unsafe path in archive: " + entry.path);
+        }
+        if (chunkCount != (entry.rawSize + CHUNK_SIZE - 1) / CHUNK_SIZE) {
+            throw std::runtime_error("Corrupt archive index: " + entry.path);
+        }
+        entry.chunks.resize(chunkCount);
+        uint64_t covered = 0;
+        for (Chunk& chunk : entry.chunks) {
+            chunk.method = static_cast<Method>(readField<uint8_t>(in));
+            chunk.rawSize = readField<uint32_t>(in);
+            chunk.offset = readField<uint64_t>(in);
+            chunk.payloadSize = readField<uint32_t>(in);
+            chunk.crc = readField<uint32_t>(in);
+            if (static_cast<uint8_t>(chunk.method) > static_cast<uint8_t>(Method::LZH)
+                || chunk.offset > indexOffset || chunk.payloadSize > indexOffset - chunk.offset
+                || (chunk.rawSize != CHUNK_SIZE && covered + chunk.rawSize != entry.rawSize)) {
+                throw std::runtime_error("Corrupt archive index: " + entry.path);
+            }
+            covered += chunk.rawSize;
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+std::vector<Archive::Entry> Archive::openIndex(const std::string& archiveFile) {
+    if (Utils::isStdio(archiveFile)) {
+        throw std::runtime_error("Archive extraction needs a seekable file, not stdin");
+    }
+    std::ifstream in(archiveFile, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open archive: " + archiveFile);
+    }
+    return readIndex(in, archiveFile);
+}
+
+const std::string& Archive::decodeChunk(const std::string& archiveFile, const Entry& e, size_t c) {
+    const Chunk& chunk = e.chunks[c];
+    thread_local std::string payload, raw;
+    {
+        FC_STAGE(Read);
+        std::ifstream& archive = threadArchive(archiveFile);
+        payload.resize(chunk.payloadSize);
+        archive.seekg(static_cast<std::streamoff>(chunk.offset));
+        archive.read(&payload[0], chunk.payloadSize);
+        if (!archive) {
+            archive.clear();
+            throw std::runtime_error("Truncated archive: " + archiveFile);
+        }
+    }
+    FC_COUNT(Blocks, 1);
+
+    const std::string* data = &payload;
+    if (chunk.method != Method::Stored) {
+        threadCodec(chunk.method).decompress(payload, raw);
+        data = &raw;
+    }
+    if (data->size() != chunk.rawSize) {
+        throw std::runtime_error("Corrupt archive chunk in: " + e.path);
+    }
+    if (Crc32c::compute(data->data(), data->size()) != chunk.crc) {
+        throw std::runtime_error("Archive checksum mismatch in: " + e.path);
+    }
+    return *data;
+}
+
+void Archive::extract(const std::string& archiveFile, const std::string& outputDir, int numThreads) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Entry> entries = openIndex(archiveFile);
+
+    uint64_t rawTotal = 0;
+    {
+        ThreadPool pool(numThreads);
+        for (Entry& entry : entries) {
+            entry.source = (fs::path(outputDir) / entry.path).string();
+            fs::path parent = fs::path(entry.source).parent_path();
+            if (!parent.empty()) fs::create_directories(parent);
+            rawTotal += entry.rawSize;
+
+            // Single-chunk files are created by their task. Others are sized
+            // up front so their chunks can land in any order.
+            if (entry.chunks.size() != 1) {
+                std::ofstream create(entry.source, std::ios::binary | std::ios::trunc);
+                if (!create) {
+                    throw std::runtime_error("Could not create: " + entry.source);
+                }
+                create.close();
+                fs::resize_file(entry.source, entry.rawSize);
+            }
+
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                pool.submit([&, c, entryPtr = &entry]() {
+                    const Entry& e = *entryPtr;
+                    const std::string& data = decodeChunk(archiveFile, e, c);
+
+                    FC_STAGE(Write);
+                    std::fstream file;
+                    if (e.chunks.size() == 1) {
+                        file.open(e.source, std::ios::binary | std::ios::out | std::ios::trunc);
+                    } else {
+                        file.open(e.source, std::ios::binary | std::ios::in | std::ios::out);
+                        file.seekp(static_cast<std::streamoff>(c * uint64_t(CHUNK_SIZE)));
+                    }
+                    file.write(data.data(), data.size());
+                    if (!file) {
+                        throw std::runtime_error("Could not write: " + e.source);
+                    }
+                });
+            }
+        }
+        pool.wait();
+    }
+
+    double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    double throughput = timeTaken > 0 ? (rawTotal / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Archive] Extraction complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Files: " << entries.size() << " | Output: " << rawTotal
+                 << " bytes | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
+}
+
+void Archive::verify(const std::string& archiveFile, int numThreads) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Entry> entries = openIndex(archiveFile);
+
+    uint64_t rawTotal = 0;
+    size_t chunkTotal = 0;
+    {
+        ThreadPool pool(numThreads);
+        for (const Entry& entry : entries) {
+            rawTotal += entry.rawSize;
+            chunkTotal += entry.chunks.size();
+            for (size_t c = 0; c < entry.chunks.size(); ++c) {
+                pool.submit([&, c, entryPtr = &entry]() { decodeChunk(archiveFile, *entryPtr, c); });
+            }
+        }
+        pool.wait();
+    }
+
+    double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    double throughput = timeTaken > 0 ? (rawTotal / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Archive] Verified.\n";
+    Utils::log() << "Threads: " << numThreads << " | Files: " << entries.size() << " | Chunks: " << chunkTotal
+                 << " | Data: " << rawTotal << " bytes | Time: " << timeTaken << "s | Throughput: " << throughput
+                 << " MB/s\n";
+}
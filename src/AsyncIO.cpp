@@ -0,0 +1,322 @@
+#include "AsyncIO.hpp"
+#include <atomic>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+    std::atomic<IoQueue::Backend> selected{IoQueue::Backend::Auto};
+}
+
+void IoQueue::setBackend(Backend backend) { selected.store(backend, std::memory_order_relaxed); }
+
+IoQueue::Backend IoQueue::backend() { return selected.load(std::memory_order_relaxed); }
+
+bool IoQueue::parseBackend(const std::string& name, Backend& backend) {
+    if (name == "auto") backend = Backend::Auto;
+    else if (name == "uring") backend = Backend::Uring;
+    else if (name == "threads") backend = Backend::Threads;
+    else if (name == "off") backend = Backend::Off;
+    else return false;
+    return true;
+}
+
+#ifdef _WIN32
+
+std::unique_ptr<IoQueue> IoQueue::create(unsigned) { return nullptr; }
+
+#else
+
+namespace {
+    struct Request {
+        bool write;
+        int fd;
+        char* data;
+        size_t size;
+        uint64_t offset;
+        uint64_t tag;
+    };
+
+    // Completes one request with blocking pread/pwrite; short transfers are
+    // returned as they are, like the kernel does for the ring.
+    int64_t perform(const Request& r) {
+        for (;;) {
+            ssize_t n = r.write ? ::pwrite(r.fd, r.data, r.size, static_cast<off_t>(r.offset))
+                                : ::pread(r.fd, r.data, r.size, static_cast<off_t>(r.offset));
+            if (n >= 0) return n;
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Fallback: a few threads draining a request queue.
+    class ThreadQueue : public IoQueue {
+    public:
+        explicit ThreadQueue(unsigned depth) {
+            unsigned count = std::max(1u, std::min(depth, 4u));
+            for (unsigned i = 0; i < count; ++i) workers.emplace_back([this]() { workerLoop(); });
+        }
+
+        // Workers only stop once the request queue is empty, so every
+        // submitted request has run before the join returns.
+        ~ThreadQueue() override {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            pending.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        void read(int fd, void* data, size_t size, uint64_t offset, uint64_t tag) override {
+            push({false, fd, static_cast<char*>(data), size, offset, tag});
+        }
+
+        void write(int fd, const void* data, size_t size, uint64_t offset, uint64_t tag) override {
+            push({true, fd, const_cast<char*>(static_cast<const char*>(data)), size, offset, tag});
+        }
+
+        Completion wait() override {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (requests.empty() && done.empty() && running == 0) {
+                throw std::logic_error("IoQueue::wait with nothing in flight");
+            }
+            finished.wait(lock, [&]() { return !done.empty(); });
+            Completion c = done.front();
+            done.pop_front();
+            return c;
+        }
+
+        const char* name() const override { return "threads"; }
+
+    private:
+        void push(const Request& request) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(request);
+            }
+            pending.notify_one();
+        }
+
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                pending.wait(lock, [&]() { return stopping || !requests.empty(); });
+                if (requests.empty()) return;
+                Request r = requests.front();
+                requests.pop_front();
+                running++;
+                lock.unlock();
+                int64_t result = perform(r);
+                lock.lock();
+                running--;
+                done.push_back({r.tag, result});
+                finished.notify_one();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable pending;
+        std::condition_variable finished;
+        std::deque<Request> requests;
+        std::deque<Completion> done;
+        unsigned running = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+
+#ifdef __linux__
+    // io_uring driven through the raw system calls, so no liburing is needed.
+    // Requests use READV/WRITEV (Linux 5.1+); each in-flight request owns a
+    // slot holding its iovec and the caller's tag, and the slot index is the
+    // ring's user_data.
+    class UringQueue : public IoQueue {
+    public:
+        static std::unique_ptr<IoQueue> open(unsigned depth) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+            if (fd < 0) return nullptr;
+            std::unique_ptr<UringQueue> queue(new UringQueue(fd, depth));
+            if (!queue->map(params)) return nullptr;
+            return queue;
+        }
+
+        ~UringQueue() override {
+            // The kernel may still be using caller buffers; reap every
+            // request before the rings go away.
+            try {
+                while (freeSlots.size() < slots.size()) wait();
+            } catch (...) {}
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+            if (sqRing) munmap(sqRing, sqRingSize);
+            ::close(ringFd);
+        }
+
+        void read(int fd, void* data, size_t size, uint64_t offset, uint64_t tag) override {
+            submit(IORING_OP_READV, fd, data, size, offset, tag);
+        }
+
+        void write(int fd, const void* data, size_t size, uint64_t offset, uint64_t tag) override {
+            submit(IORING_OP_WRITEV, fd, const_cast<void*>(data), size, offset, tag);
+        }
+
+        Completion wait() override {
+            for (;;) {
+                unsigned head = *cqHead;
+                if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    Slot& slot = slots[cqe.user_data];
+                    Completion c{slot.tag, cqe.res};
+                    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                    freeSlots.push_back(static_cast<unsigned>(&slot - slots.data()));
+                    return c;
+                }
+                if (freeSlots.size() == slots.size()) {
+                    throw std::logic_error("IoQueue::wait with nothing in flight");
+                }
+                enter(0, 1, IORING_ENTER_GETEVENTS);
+            }
+        }
+
+        const char* name() const override { return "io_uring"; }
+
+    private:
+        struct Slot {
+            iovec vec;
+            uint64_t tag;
+        };
+
+        UringQueue(int fd, unsigned depth) : ringFd(fd), slots(depth) {
+            for (unsigned i = depth; i-- > 0;) freeSlots.push_back(i);
+        }
+
+        bool map(const io_uring_params& p) {
+            sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+            sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+            if (!sqRing) return false;
+            cqRing = single ? sqRing : mapRing(cqRingSize, IORING_OFF_CQ_RING);
+            if (!cqRing) return false;
+            sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(mapRing(sqesSize, IORING_OFF_SQES));
+            if (!sqes) return false;
+
+            char* sq = static_cast<char*>(sqRing);
+            sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+            char* cq = static_cast<char*>(cqRing);
+            cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+            return true;
+        }
+
+        void* mapRing(size_t size, off_t offset) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        void submit(uint8_t opcode, int fd, void* data, size_t size, uint64_t offset, uint64_t tag) {
+            if (freeSlots.empty()) {
+                throw std::logic_error("IoQueue: more requests than its depth");
+            }
+            unsigned index = freeSlots.back();
+            freeSlots.pop_back();
+            Slot& slot = slots[index];
+            slot.vec.iov_base = data;
+            slot.vec.iov_len = size;
+            slot.tag = tag;
+
+            // Only this thread produces, so the tail needs no atomic read.
+            unsigned tail = *sqTail;
+            unsigned at = tail & *sqMask;
+            io_uring_sqe& sqe = sqes[at];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.off = offset;
+            sqe.addr = reinterpret_cast<uint64_t>(&slot.vec);
+            sqe.len = 1;
+            sqe.user_data = index;
+            sqArray[at] = at;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            enter(1, 0, 0);
+        }
+
+        // Returns once all `toSubmit` entries have been taken by the kernel
+        // (which may take fewer per call) and the wait, if any, is done.
+        void enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+            for (;;) {
+                long n = syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+                if (n >= 0) {
+                    toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(n));
+                    if (toSubmit == 0) return;
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EBUSY) {
+                    // Out of kernel resources for the moment; try again.
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (errno != EINTR) {
+                    throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                }
+            }
+        }
+
+        int ringFd;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        size_t sqRingSize = 0;
+        size_t cqRingSize = 0;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqesSize = 0;
+        unsigned* sqTail = nullptr;
+        unsigned* sqMask = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned* cqMask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        std::vector<Slot> slots;
+        std::vector<unsigned> freeSlots;
+    };
+#endif
+}
+
+std::unique_ptr<IoQueue> IoQueue::create(unsigned depth) {
+    Backend choice = backend();
+    if (choice == Backend::Off) return nullptr;
+#ifdef __linux__
+    if (choice != Backend::Threads) {
+        std::unique_ptr<IoQueue> ring = UringQueue::open(depth);
+        if (ring || choice == Backend::Uring) return ring;
+    }
+#endif
+    return std::make_unique<ThreadQueue>(depth);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "Checksum.hpp"
+#include <array>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE 1
+#endif
+
+namespace {
+    constexpr uint32_t POLY = 0x82F63B78u;   // reflected Castagnoli polynomial
+
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    constexpr Tables makeTables() {
+        Tables t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+        return t;
+    }
+
+    constexpr Tables TABLES = makeTables();
+
+    uint32_t extendSoftware(uint32_t crc, const unsigned char* p, size_t size) {
+        for (; size >= 8; size -= 8, p += 8) {
+            uint32_t lo, hi;
+            std::memcpy(&lo, p, sizeof(lo));
+            std::memcpy(&hi, p + 4, sizeof(hi));
+            lo ^= crc;
+            crc = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^ TABLES[5][(lo >> 16) & 0xFF]
+                  ^ TABLES[4][lo >> 24] ^ TABLES[3][hi & 0xFF] ^ TABLES[2][(hi >> 8) & 0xFF]
+                  ^ TABLES[1][(hi >> 16) & 0xFF] ^ TABLES[0][hi >> 24];
+        }
+        while (size--) crc = (crc >> 8) ^ TABLES[0][(crc ^ *p++) & 0xFF];
+        return crc;
+    }
+
+#ifdef CRC32C_HARDWARE
+    __attribute__((target("sse4.2")))
+    uint32_t extendHardware(uint32_t crc, const unsigned char* p, size_t size) {
+        uint64_t c = crc;
+#if defined(__x86_64__)
+        for (; size >= 8; size -= 8, p += 8) {
+            uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            c = _mm_crc32_u64(c, w);
+        }
+#endif
+        uint32_t c32 = static_cast<uint32_t>(c);
+        while (size--) c32 = _mm_crc32_u8(c32, *p++);
+        return c32;
+    }
+
+    const bool hasHardware = __builtin_cpu_supports("sse4.2");
+#endif
+
+    // a * b modulo the polynomial, bit-reflected (as in zlib's crc32_combine).
+    uint32_t multiplyModP(uint32_t a, uint32_t b) {
+        uint32_t m = 1u << 31;
+        uint32_t product = 0;
+        for (;;) {
+            if (a & m) {
+                product ^= b;
+                if ((a & (m - 1)) == 0) break;
+            }
+            m >>= 1;
+            b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+        }
+        return product;
+    }
+
+    // x^(2^k) modulo the polynomial, k = 0..31.
+    constexpr std::array<uint32_t, 32> makePowers() {
+        std::array<uint32_t, 32> t{};
+        uint32_t p = 1u << 30;   // x^1
+        t[0] = p;
+        for (int k = 1; k < 32; ++k) {
+            // Squaring, spelled out because multiplyModP is not constexpr.
+            uint32_t a = p, b = p, m = 1u << 31, product = 0;
+            for (;;) {
+                if (a & m) {
+                    product ^= b;
+                    if ((a & (m - 1)) == 0) break;
+                }
+                m >>= 1;
+                b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+            }
+            t[k] = p = product;
+        }
+        return t;
+    }
+
+    constexpr std::array<uint32_t, 32> POWERS = makePowers();
+}
+
+uint32_t Crc32c::extend(uint32_t state, const unsigned char* data, size_t size) {
+#ifdef CRC32C_HARDWARE
+    if (hasHardware) return extendHardware(state, data, size);
+#endif
+    return extendSoftware(state, data, size);
+}
+
+uint32_t Crc32c::combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+    // Shift crc(A) past lengthB zero bytes: multiply by x^(8 * lengthB).
+    uint32_t shift = 1u << 31;   // x^0
+    for (unsigned k = 3; lengthB; lengthB >>= 1, ++k) {
+        if (lengthB & 1) shift = multiplyModP(POWERS[k & 31], shift);
+    }
+    return multiplyModP(shift, crcA) ^ crcB;
+}
@@ -0,0 +1,88 @@
+#include "Codec.hpp"
+#include "Dictionary.hpp"
+#include "Huffman.hpp"
+#include "LZH.hpp"
+#include "LZW.hpp"
+#include "Stats.hpp"
+#include <stdexcept>
+
+namespace {
+    // Bytes are counted here rather than in the codecs' buffer calls, which
+    // auto mode also uses for trial encodes.
+    void countBytes(size_t in, size_t out) {
+        FC_COUNT(BytesIn, in);
+        FC_COUNT(BytesOut, out);
+    }
+
+    class HuffmanCodec : public Codec {
+    public:
+        explicit HuffmanCodec(std::shared_ptr<const Dictionary> dictionary) {
+            huffman.setDictionary(std::move(dictionary));
+        }
+        const char* name() const override { return "huffman"; }
+
+    protected:
+        void compressInto(ByteSpan input, std::string& out) override {
+            huffman.compressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+        void decompressInto(ByteSpan input, std::string& out) override {
+            huffman.decompressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+
+    private:
+        Huffman huffman;
+    };
+
+    class LZWCodec : public Codec {
+    public:
+        explicit LZWCodec(std::shared_ptr<const Dictionary> dictionary) {
+            lzw.setDictionary(std::move(dictionary));
+        }
+        const char* name() const override { return "lzw"; }
+
+    protected:
+        void compressInto(ByteSpan input, std::string& out) override {
+            lzw.compressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+        void decompressInto(ByteSpan input, std::string& out) override {
+            lzw.decompressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+
+    private:
+        LZW lzw;
+    };
+
+    class LZHCodec : public Codec {
+    public:
+        const char* name() const override { return "lzh"; }
+
+    protected:
+        void compressInto(ByteSpan input, std::string& out) override {
+            lzh.compressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+        void decompressInto(ByteSpan input, std::string& out) override {
+            lzh.decompressBuffer(input.data(), input.size(), out);
+            countBytes(input.size(), out.size());
+        }
+
+    private:
+        LZH lzh;
+    };
+}
+
+std::unique_ptr<Codec> Codec::create(const std::string& name, std::shared_ptr<const Dictionary> dictionary) {
+    if (name == "huffman") return std::make_unique<HuffmanCodec>(std::move(dictionary));
+    if (name == "lzw") return std::make_unique<LZWCodec>(std::move(dictionary));
+    if (name == "lzh") {
+        if (dictionary) {
+            throw std::runtime_error("The lzh codec does not use dictionaries");
+        }
+        return std::make_unique<LZHCodec>();
+    }
+    throw std::runtime_error("Unknown codec: " + name);
+}
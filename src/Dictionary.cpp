@@ -0,0 +1,201 @@
+#include "Dictionary.hpp"
+#include "Checksum.hpp"
+#include "Huffman.hpp"
+#include "LZW.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    template <typename T>
+    void appendField(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readField(const char*& p, const char* end) {
+        if (static_cast<size_t>(end - p) < sizeof(T)) {
+            throw std::runtime_error("Corrupt dictionary: truncated");
+        }
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+}
+
+std::shared_ptr<const Dictionary> Dictionary::train(const std::vector<std::string>& samples, unsigned lzwCodeBits) {
+    if (samples.empty()) {
+        throw std::runtime_error("Dictionary training needs at least one sample");
+    }
+    std::shared_ptr<Dictionary> dict(new Dictionary);
+
+    Huffman::Histogram freq{};
+    for (const std::string& sample : samples) {
+        Huffman::Histogram counts =
+            Huffman::buildFrequencyTable(reinterpret_cast<const unsigned char*>(sample.data()), sample.size());
+        for (int s = 0; s < 256; ++s) freq[s] += counts[s];
+    }
+    dict->lengths = Huffman::trainCodeLengths(freq);
+    dict->codeBits = lzwCodeBits;
+    dict->phrases = LZW::trainPhrases(samples, lzwCodeBits);
+
+    std::string bytes = dict->serialize();
+    std::memcpy(&dict->dictId, bytes.data() + bytes.size() - sizeof(uint32_t), sizeof(uint32_t));
+    return dict;
+}
+
+std::vector<std::string> Dictionary::readSamples(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<fs::path> files;
+    for (const std::string& path : paths) {
+        if (fs::is_directory(path)) {
+            std::vector<fs::path> found;
+            for (const auto& item : fs::recursive_directory_iterator(path)) {
+                if (item.is_regular_file()) found.push_back(item.path());
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(path)) {
+            files.push_back(path);
+        } else {
+            throw std::runtime_error("Not a file or directory: " + path);
+        }
+    }
+
+    std::vector<std::string> samples;
+    samples.reserve(files.size());
+    for (const fs::path& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream bytes;
+        bytes << in.rdbuf();
+        if (!in) {
+            throw std::runtime_error("Could not read sample: " + file.string());
+        }
+        samples.push_back(bytes.str());
+    }
+    return samples;
+}
+
+std::string Dictionary::serialize() const {
+    std::string out(MAGIC, sizeof(MAGIC));
+    appendField<uint8_t>(out, VERSION);
+    out.append(reinterpret_cast<const char*>(lengths.data()), lengths.size());
+    appendField<uint8_t>(out, static_cast<uint8_t>(codeBits));
+    appendField<uint32_t>(out, static_cast<uint32_t>(phrases.size()));
+    for (const Phrase& phrase : phrases) {
+        appendField<uint32_t>(out, phrase.prefix);
+        appendField<uint8_t>(out, phrase.byte);
+    }
+    appendField<uint32_t>(out, Crc32c::compute(out.data(), out.size()));
+    return out;
+}
+
+std::shared_ptr<const Dictionary> Dictionary::parse(const char* data, size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+    if (size < sizeof(MAGIC) || std::memcmp(p, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a dictionary");
+    }
+    p += sizeof(MAGIC);
+    if (readField<uint8_t>(p, end) != VERSION) {
+        throw std::runtime_error("Unsupported dictionary version");
+    }
+
+    std::shared_ptr<Dictionary> dict(new Dictionary);
+    if (static_cast<size_t>(end - p) < dict->lengths.size()) {
+        throw std::runtime_error("Corrupt dictionary: truncated");
+    }
+    std::memcpy(dict->lengths.data(), p, dict->lengths.size());
+    p += dict->lengths.size();
+    dict->codeBits = readField<uint8_t>(p, end);
+    uint32_t count = readField<uint32_t>(p, end);
+    if (count > static_cast<size_t>(end - p) / (sizeof(uint32_t) + sizeof(uint8_t))) {
+        throw std::runtime_error("Corrupt dictionary: truncated");
+    }
+    dict->phrases.resize(count);
+    for (Phrase& phrase : dict->phrases) {
+        phrase.prefix = readField<uint32_t>(p, end);
+        phrase.byte = readField<uint8_t>(p, end);
+    }
+    size_t bodySize = static_cast<size_t>(p - data);
+    dict->dictId = readField<uint32_t>(p, end);
+    if (p != end || dict->dictId != Crc32c::compute(data, bodySize)) {
+        throw std::runtime_error("Corrupt dictionary: checksum mismatch");
+    }
+    return dict;
+}
+
+std::shared_ptr<const Dictionary> Dictionary::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open dictionary: " + path);
+    }
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    std::string data = bytes.str();
+    try {
+        return parse(data.data(), data.size());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string(e.what()) + ": " + path);
+    }
+}
+
+std::string Dictionary::save(const std::string& dir) const {
+    if (!dir.empty()) std::filesystem::create_directories(dir);
+    std::string path = pathFor(dir, dictId);
+    std::string bytes = serialize();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Could not write dictionary: " + path);
+    }
+    return path;
+}
+
+std::string Dictionary::formatId(uint32_t id) {
+    char text[9];
+    std::snprintf(text, sizeof(text), "%08x", id);
+    return text;
+}
+
+uint32_t Dictionary::parseId(const std::string& text) {
+    size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(text, &used, 16);
+    } catch (...) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || text.size() > 8) {
+        throw std::runtime_error("Invalid dictionary ID: " + text);
+    }
+    return static_cast<uint32_t>(value);
+}
+
+std::string Dictionary::pathFor(const std::string& dir, uint32_t id) {
+    return (std::filesystem::path(dir.empty() ? "." : dir) / (formatId(id) + ".dict")).string();
+}
+
+std::shared_ptr<const Dictionary> Dictionary::resolve(const std::shared_ptr<const Dictionary>& current,
+                                                      const std::string& dir, uint32_t id) {
+    if (current && current->id() == id) return current;
+    if (dir.empty()) {
+        throw std::runtime_error("Stream was compressed with dictionary " + formatId(id)
+                                 + ", which is not loaded");
+    }
+    std::string path = pathFor(dir, id);
+    if (!std::filesystem::exists(path)) {
+        throw std::runtime_error("Stream was compressed with dictionary " + formatId(id) + ", not found at " + path);
+    }
+    std::shared_ptr<const Dictionary> dict = load(path);
+    if (dict->id() != id) {
+        throw std::runtime_error("Dictionary file does not match its ID: " + path);
+    }
+    return dict;
+}
@@ -0,0 +1,599 @@
+#include "FileIO.hpp"
+#include "AsyncIO.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr size_t STREAM_BUFFER_SIZE = 1 << 20;
+    // Buffers of STREAM_BUFFER_SIZE kept in flight by queued reads and writes.
+    constexpr unsigned IO_QUEUE_DEPTH = 4;
+}
+
+// ---------------------------------------------------------------------------
+// MappedFile
+// ---------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size;
+    if (GetFileType(fh) != FILE_TYPE_DISK || !GetFileSizeEx(fh, &size)) {
+        CloseHandle(fh);
+        return nullptr;
+    }
+    std::unique_ptr<MappedFile> map(new MappedFile());
+    map->fileHandle = fh;
+    map->length = static_cast<size_t>(size.QuadPart);
+    if (map->length == 0) return map;
+
+    map->mappingHandle = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!map->mappingHandle) return nullptr;
+    map->base = static_cast<const unsigned char*>(MapViewOfFile(map->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!map->base) return nullptr;
+    return map;
+}
+
+MappedFile::~MappedFile() {
+    if (base) UnmapViewOfFile(base);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    // Check the type before opening: opening a FIFO here would block and then
+    // drop its writer before the stream fallback gets to read from it.
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<MappedFile> map(new MappedFile());
+    map->length = static_cast<size_t>(st.st_size);
+    if (map->length > 0) {
+        void* p = mmap(nullptr, map->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+        madvise(p, map->length, MADV_SEQUENTIAL);
+        map->base = static_cast<const unsigned char*>(p);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    return map;
+}
+
+MappedFile::~MappedFile() {
+    if (base) munmap(const_cast<unsigned char*>(base), length);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// InputFile
+// ---------------------------------------------------------------------------
+
+InputFile::SpanBuf::SpanBuf(const unsigned char* data, size_t size) {
+    char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+    setg(begin, begin, begin + size);
+}
+
+InputFile::SpanBuf::pos_type InputFile::SpanBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                         std::ios_base::openmode which) {
+    if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+    off_type base = dir == std::ios_base::beg ? 0
+                  : dir == std::ios_base::cur ? gptr() - eback()
+                  : egptr() - eback();
+    off_type target = base + off;
+    if (target < 0 || target > egptr() - eback()) return pos_type(off_type(-1));
+    setg(eback(), eback() + target, egptr());
+    return pos_type(target);
+}
+
+InputFile::SpanBuf::pos_type InputFile::SpanBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+#ifdef _WIN32
+
+class InputFile::PrefetchBuf : public std::streambuf {
+public:
+    static std::unique_ptr<PrefetchBuf> create(const std::string&) { return nullptr; }
+};
+
+#else
+
+// Get area over one of IO_QUEUE_DEPTH buffers that are read ahead in file
+// order. Once the stream moves past a buffer it is queued again for the next
+// unread range, so the reads for the following blocks are already running
+// while the current one is being coded.
+class InputFile::PrefetchBuf : public std::streambuf {
+public:
+    static std::unique_ptr<PrefetchBuf> create(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+        std::unique_ptr<IoQueue> queue = IoQueue::create(IO_QUEUE_DEPTH);
+        if (!queue) return nullptr;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return nullptr;
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return std::unique_ptr<PrefetchBuf>(new PrefetchBuf(fd, static_cast<uint64_t>(st.st_size), std::move(queue)));
+    }
+
+    ~PrefetchBuf() override {
+        // The kernel or a worker may still be writing into the buffers;
+        // destroying the queue waits for whatever drain() could not reap.
+        try { drain(); } catch (...) {}
+        queue.reset();
+        ::close(fd);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (started) {
+            if (ended) return traits_type::eof();
+            enqueue(current);
+            current = (current + 1) % IO_QUEUE_DEPTH;
+        }
+        started = true;
+
+        Buffer& b = buffers[current];
+        if (b.size == 0) return traits_type::eof();
+        if (b.inFlight) {
+            FC_STAGE(Read);
+            while (b.inFlight) complete(queue->wait());
+        }
+        if (b.result < 0) {
+            // Thrown through istream::read, which turns it into badbit.
+            throw std::runtime_error(std::string("Could not read input: ") + std::strerror(static_cast<int>(-b.result)));
+        }
+        size_t got = static_cast<size_t>(b.result);
+        if (got < b.size) {
+            got += readRest(b, got);
+            // The file shrank since it was opened; stop at what is there.
+            if (got < b.size) {
+                ended = true;
+                if (got == 0) return traits_type::eof();
+            }
+        }
+        setg(b.data.data(), b.data.data(), b.data.data() + got);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    struct Buffer {
+        std::vector<char> data;
+        uint64_t offset = 0;
+        size_t size = 0;
+        int64_t result = 0;
+        bool inFlight = false;
+    };
+
+    PrefetchBuf(int fd, uint64_t fileSize, std::unique_ptr<IoQueue> queue)
+        : fd(fd), fileSize(fileSize), queue(std::move(queue)) {
+        for (unsigned i = 0; i < IO_QUEUE_DEPTH; ++i) enqueue(i);
+    }
+
+    // Queues buffer `i` for the next range of the file, if any is left.
+    void enqueue(unsigned i) {
+        Buffer& b = buffers[i];
+        b.size = static_cast<size_t>(std::min<uint64_t>(STREAM_BUFFER_SIZE, fileSize - next));
+        if (b.size == 0) return;
+        if (b.data.size() < b.size) b.data.resize(b.size);
+        b.offset = next;
+        next += b.size;
+        b.inFlight = true;
+        queue->read(fd, b.data.data(), b.size, b.offset, i);
+    }
+
+    void complete(const IoQueue::Completion& c) {
+        Buffer& b = buffers[c.tag];
+        b.result = c.result;
+        b.inFlight = false;
+    }
+
+    // Finishes a short read synchronously; returns the extra bytes read.
+    size_t readRest(Buffer& b, size_t got) {
+        size_t start = got;
+        while (got < b.size) {
+            ssize_t n = ::pread(fd, b.data.data() + got, b.size - got, static_cast<off_t>(b.offset + got));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error(std::string("Could not read input: ") + std::strerror(errno));
+            if (n == 0) break;
+            got += static_cast<size_t>(n);
+        }
+        return got - start;
+    }
+
+    void drain() {
+        for (;;) {
+            bool waiting = false;
+            for (const Buffer& b : buffers) waiting = waiting || b.inFlight;
+            if (!waiting) return;
+            complete(queue->wait());
+        }
+    }
+
+    int fd;
+    uint64_t fileSize;
+    uint64_t next = 0;
+    Buffer buffers[IO_QUEUE_DEPTH];
+    // Declared after the buffers so it is destroyed, and its requests
+    // finished, before they are freed.
+    std::unique_ptr<IoQueue> queue;
+    unsigned current = 0;
+    bool started = false;
+    bool ended = false;
+};
+
+#endif
+
+InputFile::InputFile(const std::string& path, Access access) {
+    if (Utils::isStdio(path)) {
+        Utils::setBinaryMode(stdin);
+        in = &std::cin;
+        return;
+    }
+    if (access == Access::Streamed) {
+        prefetchBuf = PrefetchBuf::create(path);
+        if (prefetchBuf) {
+            prefetchStream = std::make_unique<std::istream>(prefetchBuf.get());
+            in = prefetchStream.get();
+            return;
+        }
+    }
+    map = MappedFile::open(path);
+    if (map) {
+        spanBuf = std::make_unique<SpanBuf>(map->data(), map->size());
+        spanStream = std::make_unique<std::istream>(spanBuf.get());
+        in = spanStream.get();
+        return;
+    }
+    // Not mappable (FIFO, device, ...): plain buffered reads.
+    buffer.resize(STREAM_BUFFER_SIZE);
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open input file: " + path);
+    }
+    in = &file;
+}
+
+InputFile::~InputFile() = default;
+
+// ---------------------------------------------------------------------------
+// OutputFile
+// ---------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+// Writable mappings are not used on Windows; outputs take the buffered path.
+class OutputFile::MappedBuf : public std::streambuf {
+public:
+    static std::unique_ptr<MappedBuf> create(const std::string&, uint64_t) { return nullptr; }
+    void finish() {}
+};
+
+class OutputFile::QueuedBuf : public std::streambuf {
+public:
+    static std::unique_ptr<QueuedBuf> create(const std::string&) { return nullptr; }
+    void finish() {}
+};
+
+#else
+
+// Put area spanning a shared writable mapping of the output file.
+class OutputFile::MappedBuf : public std::streambuf {
+public:
+    static std::unique_ptr<MappedBuf> create(const std::string& path, uint64_t expectedSize) {
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) return nullptr;
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return nullptr;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return nullptr;
+        }
+        std::unique_ptr<MappedBuf> buf(new MappedBuf(fd));
+        if (!buf->remap(static_cast<size_t>(expectedSize))) return nullptr;
+        return buf;
+    }
+
+    ~MappedBuf() override {
+        try { finish(); } catch (...) {}
+    }
+
+    // Unmaps and truncates the file to the bytes actually written.
+    void finish() {
+        if (fd < 0) return;
+        size_t written = pptr() - pbase();
+        bool ok = true;
+        if (base) ok = munmap(base, capacity) == 0;
+        ok = ftruncate(fd, static_cast<off_t>(written)) == 0 && ok;
+        ok = ::close(fd) == 0 && ok;
+        fd = -1;
+        base = nullptr;
+        setp(nullptr, nullptr);
+        if (!ok) {
+            throw std::runtime_error("Could not finalize mapped output file");
+        }
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        if (!remap(std::max<size_t>(capacity * 2, 1 << 16))) return traits_type::eof();
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        size_t avail = epptr() - pptr();
+        if (static_cast<size_t>(n) > avail) {
+            size_t used = pptr() - pbase();
+            if (!remap(std::max(capacity * 2, used + static_cast<size_t>(n)))) return 0;
+        }
+        std::memcpy(pptr(), s, static_cast<size_t>(n));
+        // pbump takes an int; advance in safe steps for very large writes.
+        for (std::streamsize left = n; left > 0;) {
+            int step = static_cast<int>(std::min<std::streamsize>(left, 1 << 30));
+            pbump(step);
+            left -= step;
+        }
+        return n;
+    }
+
+private:
+    explicit MappedBuf(int fd) : fd(fd) {}
+
+    // Grow the file to `newCapacity` and map it, keeping the write offset.
+    // The blocks are reserved up front: a sparse file would hit a full disk
+    // on a page fault, which is SIGBUS rather than a write error.
+    bool remap(size_t newCapacity) {
+        size_t used = base ? static_cast<size_t>(pptr() - pbase()) : 0;
+        if (base && munmap(base, capacity) != 0) return false;
+        base = nullptr;
+        if (newCapacity == 0 || posix_fallocate(fd, 0, static_cast<off_t>(newCapacity)) != 0) return false;
+        void* p = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        madvise(p, newCapacity, MADV_SEQUENTIAL);
+        base = static_cast<char*>(p);
+        capacity = newCapacity;
+        setp(base, base + capacity);
+        for (size_t left = used; left > 0;) {
+            int step = static_cast<int>(std::min<size_t>(left, 1 << 30));
+            pbump(step);
+            left -= step;
+        }
+        return true;
+    }
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0;
+};
+
+// Put area over one of IO_QUEUE_DEPTH buffers. A full buffer is queued as a
+// positioned write and filling continues in the next one; the writer only
+// waits when every buffer is still being written.
+class OutputFile::QueuedBuf : public std::streambuf {
+public:
+    static std::unique_ptr<QueuedBuf> create(const std::string& path) {
+        // Like MappedBuf, never open FIFOs or devices here.
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) return nullptr;
+        std::unique_ptr<IoQueue> queue = IoQueue::create(IO_QUEUE_DEPTH);
+        if (!queue) return nullptr;
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return nullptr;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return nullptr;
+        }
+        return std::unique_ptr<QueuedBuf>(new QueuedBuf(fd, std::move(queue)));
+    }
+
+    ~QueuedBuf() override {
+        try { finish(); } catch (...) {}
+    }
+
+    // Writes what is buffered, waits for every write and closes the file.
+    void finish() {
+        if (fd < 0) return;
+        bool ok = rotate();
+        try {
+            drain();
+        } catch (...) {
+            // Let the queue finish what is still in flight before the
+            // descriptor closes under it.
+            queue.reset();
+            for (Buffer& b : buffers) b.inFlight = false;
+            ok = false;
+        }
+        ok = ::close(fd) == 0 && ok && !failed;
+        fd = -1;
+        setp(nullptr, nullptr);
+        if (!ok) {
+            throw std::runtime_error("Could not write output file");
+        }
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        if (!rotate()) return traits_type::eof();
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+    int sync() override {
+        if (!rotate()) return -1;
+        drain();
+        return failed ? -1 : 0;
+    }
+
+private:
+    struct Buffer {
+        std::vector<char> data;
+        uint64_t offset = 0;
+        size_t size = 0;
+        bool inFlight = false;
+    };
+
+    QueuedBuf(int fd, std::unique_ptr<IoQueue> queue) : fd(fd), queue(std::move(queue)) {
+        buffers[0].data.resize(STREAM_BUFFER_SIZE);
+        setp(buffers[0].data.data(), buffers[0].data.data() + STREAM_BUFFER_SIZE);
+    }
+
+    // Queues the current buffer, if it holds anything, and moves the put
+    // area to the next free one. False once a write has failed.
+    bool rotate() {
+        if (failed || fd < 0) return false;
+        size_t used = static_cast<size_t>(pptr() - pbase());
+        if (used == 0) return true;
+        Buffer& b = buffers[current];
+        b.offset = offset;
+        b.size = used;
+        b.inFlight = true;
+        offset += used;
+        queue->write(fd, b.data.data(), b.size, b.offset, current);
+
+        current = (current + 1) % IO_QUEUE_DEPTH;
+        Buffer& next = buffers[current];
+        if (next.inFlight) {
+            FC_STAGE(Write);
+            while (next.inFlight) complete(queue->wait());
+        }
+        if (next.data.empty()) next.data.resize(STREAM_BUFFER_SIZE);
+        setp(next.data.data(), next.data.data() + STREAM_BUFFER_SIZE);
+        return !failed;
+    }
+
+    void complete(const IoQueue::Completion& c) {
+        Buffer& b = buffers[c.tag];
+        b.inFlight = false;
+        if (c.result < 0) {
+            failed = true;
+            return;
+        }
+        // A short write (disk nearly full, signal) is finished here, which
+        // also surfaces ENOSPC for the part that did not fit.
+        for (size_t done = static_cast<size_t>(c.result); done < b.size;) {
+            ssize_t n = ::pwrite(fd, b.data.data() + done, b.size - done, static_cast<off_t>(b.offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                failed = true;
+                return;
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+
+    void drain() {
+        FC_STAGE(Write);
+        for (;;) {
+            bool waiting = false;
+            for (const Buffer& b : buffers) waiting = waiting || b.inFlight;
+            if (!waiting) return;
+            complete(queue->wait());
+        }
+    }
+
+    int fd;
+    Buffer buffers[IO_QUEUE_DEPTH];
+    // After the buffers, as in PrefetchBuf.
+    std::unique_ptr<IoQueue> queue;
+    unsigned current = 0;
+    uint64_t offset = 0;
+    bool failed = false;
+};
+
+#endif
+
+OutputFile::OutputFile(const std::string& path, uint64_t expectedSize) {
+    if (Utils::isStdio(path)) {
+        Utils::setBinaryMode(stdout);
+        Utils::stdoutCarriesData() = true;
+        out = &std::cout;
+        return;
+    }
+    if (expectedSize != UNKNOWN_SIZE && expectedSize > 0) {
+        mappedBuf = MappedBuf::create(path, expectedSize);
+        if (mappedBuf) {
+            mappedStream = std::make_unique<std::ostream>(mappedBuf.get());
+            out = mappedStream.get();
+            return;
+        }
+    }
+    queuedBuf = QueuedBuf::create(path);
+    if (queuedBuf) {
+        queuedStream = std::make_unique<std::ostream>(queuedBuf.get());
+        out = queuedStream.get();
+        return;
+    }
+    buffer.resize(STREAM_BUFFER_SIZE);
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open output file: " + path);
+    }
+    out = &file;
+}
+
+OutputFile::~OutputFile() {
+    if (closed) return;
+    try { close(); } catch (...) {}
+}
+
+void OutputFile::close() {
+    if (closed) return;
+    closed = true;
+    bool ok = static_cast<bool>(*out);
+    if (mappedBuf) {
+        mappedBuf->finish();
+    } else if (queuedBuf) {
+        queuedBuf->finish();
+    } else if (file.is_open()) {
+        file.close();
+        ok = ok && !file.fail();
+    } else {
+        out->flush();
+        ok = ok && static_cast<bool>(*out);
+    }
+    if (!ok) {
+        throw std::runtime_error("Could not write output");
+    }
+}
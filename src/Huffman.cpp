@@ -1,269 +1,1131 @@
 #include "Huffman.hpp"
-#include <fstream>
+#include "BitIO.hpp"
+#include "Checksum.hpp"
+#include "Dictionary.hpp"
+#include "FileIO.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <array>
 #include <iostream>
-#include <bitset>
 #include <chrono>
-#include <filesystem>
+#include <cstring>
 #include <thread>
-#include <mutex>
 #include <vector>
 
-void Huffman::writeBitstream(const std::string& bits, const std::string& outputFile, const std::unordered_map<char, int>& freqMap) {
-    std::ofstream out(outputFile, std::ios::binary);
-    if (!out.is_open()) {
-        throw std::runtime_error("Could not open output file: " + outputFile);
+namespace {
+    constexpr size_t IO_BUFFER_SIZE = 1 << 16;
+    constexpr size_t DECODE_BUFFER_SIZE = 1 << 20;
+    // Below this size per thread, splitting the histogram is not worth a thread.
+    constexpr size_t MIN_HISTOGRAM_SLICE = size_t(4) << 20;
+
+    // buildLengths scratch, one per thread. It grows to the largest alphabet
+    // seen and is then reused, so building a code for every block or LZH
+    // segment does not touch the allocator.
+    struct LengthScratch {
+        std::vector<uint64_t> order;        // used symbols by frequency
+        std::vector<uint64_t> depth;
+        std::vector<unsigned> depthCount;
+    };
+
+    LengthScratch& lengthScratch() {
+        thread_local LengthScratch scratch;
+        return scratch;
     }
 
-    // --- HEADER ---
-    // 1. Write number of unique symbols
-    int uniqueCount = freqMap.size();
-    out.write(reinterpret_cast<const char*>(&uniqueCount), sizeof(uniqueCount));
+    // Huffman tree depths in place (Moffat and Katajainen). `a` holds n >= 2
+    // weights in ascending order and ends up holding each leaf's depth. This
+    // is the two-queue construction: leaves are taken from the front of `a`,
+    // internal nodes are created in weight order behind them, so the lighter
+    // queue head is always one of two candidates. The same array then holds
+    // parent links and internal node depths; there is no pointer tree.
+    void treeDepths(uint64_t* a, size_t n) {
+        size_t root = 0;    // next internal node to pair
+        size_t leaf = 2;    // next leaf to pair
+        a[0] += a[1];
+        for (size_t next = 1; next < n - 1; ++next) {
+            if (leaf >= n || a[root] < a[leaf]) {
+                a[next] = a[root];
+                a[root++] = next;
+            } else {
+                a[next] = a[leaf++];
+            }
+            if (leaf >= n || (root < next && a[root] < a[leaf])) {
+                a[next] += a[root];
+                a[root++] = next;
+            } else {
+                a[next] += a[leaf++];
+            }
+        }
+
+        // Internal node depths from their parent links, root (n - 2) first.
+        a[n - 2] = 0;
+        for (size_t next = n - 2; next-- > 0;) a[next] = a[a[next]] + 1;
 
-    // 2. Write (char, freq) pairs to reconstruct tree later
-    for (auto& p : freqMap) {
-        out.write(&p.first, sizeof(char));
-        out.write(reinterpret_cast<const char*>(&p.second), sizeof(int));
+        // Leaf depths: each level's free slots not taken by internal nodes
+        // are leaves, handed out from the heaviest end of `a`.
+        size_t available = 1, used = 0, d = 0;
+        ptrdiff_t internal = static_cast<ptrdiff_t>(n) - 2;
+        size_t next = n;
+        while (available > 0) {
+            while (internal >= 0 && a[internal] == d) {
+                used++;
+                internal--;
+            }
+            while (available > used) {
+                a[--next] = d;
+                available--;
+            }
+            available = 2 * used;
+            d++;
+            used = 0;
+        }
     }
 
-    // Write bit length (important for exact decompression)
-    int bitLen = static_cast<int>(bits.size());
-    out.write(reinterpret_cast<const char*>(&bitLen), sizeof(bitLen));
+    // Counts bytes into four interleaved tables: consecutive bytes land in
+    // different tables, so runs of one value do not serialize on a single
+    // counter's store-to-load dependency. Eight bytes are loaded per step.
+    void countBytes(const unsigned char* data, size_t size, Huffman::Histogram& freq) {
+        uint64_t counts[4][256] = {};
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, data + i, sizeof(w));
+            counts[0][w & 0xFF]++;
+            counts[1][(w >> 8) & 0xFF]++;
+            counts[2][(w >> 16) & 0xFF]++;
+            counts[3][(w >> 24) & 0xFF]++;
+            counts[0][(w >> 32) & 0xFF]++;
+            counts[1][(w >> 40) & 0xFF]++;
+            counts[2][(w >> 48) & 0xFF]++;
+            counts[3][w >> 56]++;
+        }
+        for (; i < size; ++i) counts[0][data[i]]++;
+        for (int s = 0; s < 256; ++s) {
+            freq[s] += counts[0][s] + counts[1][s] + counts[2][s] + counts[3][s];
+        }
+    }
 
-    // --- COMPRESSED DATA ---
-    unsigned char buffer = 0;
-    int bitCount = 0;
-    for (char b : bits) {
-        buffer <<= 1;
-        if (b == '1') buffer |= 1;
-        bitCount++;
-        if (bitCount == 8) {
-            out.write(reinterpret_cast<char*>(&buffer), 1);
-            buffer = 0;
-            bitCount = 0;
+    template <typename T>
+    void appendField(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readField(const char*& p, const char* end) {
+        if (static_cast<size_t>(end - p) < sizeof(T)) {
+            throw std::runtime_error("Corrupt Huffman block: truncated frame");
+        }
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    // LEB128: 7 bits per byte, low bits first; small sizes take one byte.
+    void appendVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
         }
+        out.push_back(static_cast<char>(value));
     }
 
-    // Write remaining bits (if not aligned to 8)
-    if (bitCount > 0) {
-        buffer <<= (8 - bitCount);
-        out.write(reinterpret_cast<char*>(&buffer), 1);
+    uint64_t readVarint(const char*& p, const char* end) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p == end) break;
+            uint8_t byte = static_cast<uint8_t>(*p++);
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("Corrupt Huffman header: bad size");
+    }
+
+    std::string readRest(std::istream& in, const char* prefix, size_t prefixSize) {
+        std::string data(prefix, prefixSize);
+        std::vector<char> buffer(IO_BUFFER_SIZE);
+        while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+            data.append(buffer.data(), static_cast<size_t>(in.gcount()));
+        }
+        if (in.bad()) {
+            throw std::runtime_error("Could not read input");
+        }
+        return data;
     }
+}
 
-    out.close();
+size_t Huffman::codeTableSize(uint16_t symbolCount) {
+    return symbolCount <= PACKED_TABLE_THRESHOLD ? 2 * size_t(symbolCount) : 128;
 }
 
-std::unordered_map<char, int> Huffman::buildFrequencyTable(const std::string& inputFile) {
-    std::unordered_map<char, int> freqMap;
-    std::ifstream in(inputFile, std::ios::binary);
-    if(!in.is_open()){
-        throw std::runtime_error("Could not open input file: " + inputFile);
+void Huffman::appendCodeLengths(std::string& out, const CodeLengths& lengths, uint16_t symbolCount) {
+    if (symbolCount <= PACKED_TABLE_THRESHOLD) {
+        for (int s = 0; s < 256; ++s) {
+            if (!lengths[s]) continue;
+            out.push_back(static_cast<char>(s));
+            out.push_back(static_cast<char>(lengths[s]));
+        }
+        return;
+    }
+    for (int s = 0; s < 256; s += 2) {
+        out.push_back(static_cast<char>(lengths[s] | (lengths[s + 1] << 4)));
     }
+}
 
-    char c;
-    while (in.get(c)) {
-        freqMap[c]++;
+Huffman::CodeLengths Huffman::parseCodeLengths(const char* p, const char* end, uint16_t symbolCount) {
+    if (symbolCount > 256 || static_cast<size_t>(end - p) < codeTableSize(symbolCount)) {
+        throw std::runtime_error("Corrupt Huffman code table");
+    }
+    CodeLengths lengths{};
+    if (symbolCount <= PACKED_TABLE_THRESHOLD) {
+        for (uint16_t i = 0; i < symbolCount; ++i) {
+            uint8_t symbol = static_cast<uint8_t>(p[2 * i]);
+            uint8_t len = static_cast<uint8_t>(p[2 * i + 1]);
+            if (len == 0 || len > MAX_CODE_LEN) {
+                throw std::runtime_error("Corrupt Huffman code table: bad code length");
+            }
+            lengths[symbol] = len;
+        }
+    } else {
+        for (int s = 0; s < 256; s += 2) {
+            uint8_t packed = static_cast<uint8_t>(p[s / 2]);
+            lengths[s] = packed & 0x0F;
+            lengths[s + 1] = packed >> 4;
+        }
     }
-    return freqMap;
+    // Reject tables that do not describe a prefix code; the decode tables
+    // are sized on that assumption.
+    uint32_t kraft = 0;
+    uint16_t count = 0;
+    for (uint8_t len : lengths) {
+        if (!len) continue;
+        kraft += 1u << (MAX_CODE_LEN - len);
+        count++;
+    }
+    if (count != symbolCount || kraft > (1u << MAX_CODE_LEN)) {
+        throw std::runtime_error("Corrupt Huffman code table");
+    }
+    return lengths;
 }
 
-std::shared_ptr<Huffman::Node> Huffman::buildTree(const std::unordered_map<char, int>& freqMap) {
-    std::priority_queue<std::shared_ptr<Node>, std::vector<std::shared_ptr<Node>>, Compare> pq;
+Huffman::StreamPlan Huffman::planStream(const Histogram& freq, uint64_t rawSize) {
+    FC_STAGE(Table);
+    StreamPlan plan;
+    CodeLengths lengths = buildCodeLengths(freq);
+    plan.codes = buildCanonicalCodes(lengths);
+    uint16_t symbolCount = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (!freq[s]) continue;
+        plan.bitLen += freq[s] * plan.codes[s].len;
+        symbolCount++;
+    }
+
+    plan.header.assign(STREAM_MAGIC, sizeof(STREAM_MAGIC));
+    appendField<uint8_t>(plan.header, STREAM_VERSION);
+    appendField<uint64_t>(plan.header, rawSize);
+    appendField<uint64_t>(plan.header, plan.bitLen);
+    appendField<uint16_t>(plan.header, symbolCount);
+    appendCodeLengths(plan.header, lengths, symbolCount);
+    return plan;
+}
 
-    for (auto& pair : freqMap) {
-        pq.push(std::make_shared<Node>(pair.first, pair.second));
+Huffman::StreamHeader Huffman::parseStreamHeader(const char* p, const char* end) {
+    if (static_cast<size_t>(end - p) < STREAM_FIXED_SIZE || std::memcmp(p, STREAM_MAGIC, sizeof(STREAM_MAGIC)) != 0) {
+        throw std::runtime_error("Not a Huffman stream");
+    }
+    const char* begin = p;
+    p += sizeof(STREAM_MAGIC);
+    StreamHeader header;
+    uint8_t version = readField<uint8_t>(p, end);
+    header.rawSize = readField<uint64_t>(p, end);
+    header.bitLen = readField<uint64_t>(p, end);
+    uint16_t symbolCount = readField<uint16_t>(p, end);
+    if (version != STREAM_VERSION) {
+        throw std::runtime_error("Unsupported Huffman stream version");
     }
-    while (pq.size() > 1) {
-        auto left = pq.top(); pq.pop();
-        auto right = pq.top(); pq.pop();
-        auto parent = std::make_shared<Node>(left, right);
-        pq.push(parent);
+    header.lengths = parseCodeLengths(p, end, symbolCount);
+    if (header.rawSize > 0 && symbolCount == 0) {
+        throw std::runtime_error("Corrupt Huffman header");
     }
-    return pq.empty() ? nullptr : pq.top();
+    header.size = static_cast<size_t>(p - begin) + codeTableSize(symbolCount);
+    return header;
 }
-void Huffman::buildEncodingTable(std::shared_ptr<Node> root, const std::string& str) {
-    if (!root) return;
 
-    if (!root->left && !root->right) {
-        encodingTable[root->ch] = str.empty() ? "0" : str; // Handle single character case
+uint32_t Huffman::encodeSymbols(const CodeTable& codes, const unsigned char* data, size_t size, BitWriter& writer) {
+    FC_STAGE(Encode);
+    unsigned maxLen = 0;
+    for (const Code& c : codes) maxLen = std::max<unsigned>(maxLen, c.len);
+    if (maxLen <= 8) return encodeSymbolsWith<8>(codes, data, size, writer);
+    if (maxLen <= 10) return encodeSymbolsWith<10>(codes, data, size, writer);
+    if (maxLen <= 12) return encodeSymbolsWith<12>(codes, data, size, writer);
+    return encodeSymbolsWith<MAX_CODE_LEN>(codes, data, size, writer);
+}
+
+template <unsigned MaxLen>
+uint32_t Huffman::encodeSymbolsWith(const CodeTable& codes, const unsigned char* data, size_t size,
+                                    BitWriter& writer) {
+    // BATCH codes of at most MaxLen bits always fit the 63 bits one write()
+    // takes, so they are joined in a register with no bounds checks and the
+    // writer's accumulator is touched once per batch.
+    constexpr unsigned BATCH = 63 / MaxLen;
+    static_assert(MaxLen <= MAX_CODE_LEN && BATCH >= 1, "code length preset out of range");
+    Crc32c crc;
+    for (size_t start = 0; start < size; start += IO_BUFFER_SIZE) {
+        size_t end = std::min(size, start + IO_BUFFER_SIZE);
+        crc.update(data + start, end - start);
+        size_t i = start;
+        for (; i + BATCH <= end; i += BATCH) {
+            uint64_t bits = 0;
+            unsigned len = 0;
+            for (unsigned k = 0; k < BATCH; ++k) {
+                const Code& c = codes[data[i + k]];
+                bits = (bits << c.len) | c.bits;
+                len += c.len;
+            }
+            writer.write(bits, len);
+        }
+        for (; i < end; ++i) {
+            const Code& c = codes[data[i]];
+            writer.write(c.bits, c.len);
+        }
+    }
+    return crc.value();
+}
+
+Huffman::Histogram Huffman::buildFrequencyTable(const unsigned char* data, size_t size, int numThreads) {
+    FC_STAGE(Histogram);
+    Histogram freq{};
+    size_t slices = std::min<size_t>(std::max(numThreads, 1), size / MIN_HISTOGRAM_SLICE);
+    if (slices <= 1) {
+        countBytes(data, size, freq);
+        return freq;
+    }
+
+    // Each thread counts one contiguous slice into its own histogram; the
+    // partial counts are summed afterwards.
+    std::vector<Histogram> partial(slices, Histogram{});
+    std::vector<std::thread> threads;
+    size_t sliceSize = size / slices;
+    for (size_t t = 0; t < slices; ++t) {
+        size_t begin = t * sliceSize;
+        size_t len = t + 1 == slices ? size - begin : sliceSize;
+        threads.emplace_back(countBytes, data + begin, len, std::ref(partial[t]));
+    }
+    for (auto& th : threads) th.join();
+    for (const Histogram& h : partial) {
+        for (int s = 0; s < 256; ++s) freq[s] += h[s];
+    }
+    return freq;
+}
+
+void Huffman::buildLengths(const uint64_t* freq, size_t count, unsigned maxLen, uint8_t* lengths) {
+    std::fill(lengths, lengths + count, 0);
+    LengthScratch& scratch = lengthScratch();
+    std::vector<uint64_t>& order = scratch.order;
+    order.clear();
+    uint64_t maxFreq = 0;
+    for (size_t s = 0; s < count; ++s) {
+        if (!freq[s]) continue;
+        order.push_back(s);
+        maxFreq = std::max(maxFreq, freq[s]);
+    }
+    if (order.empty()) return;
+    // Handle single character case: it still needs a 1-bit code
+    if (order.size() == 1) {
+        lengths[order[0]] = 1;
+        return;
+    }
+    if (count > (size_t(1) << maxLen)) {
+        throw std::runtime_error("Huffman alphabet too large for the code length limit");
+    }
+
+    // Ascending frequency, ties by descending symbol: walked backwards this
+    // is most frequent first, ties by symbol, the order lengths go out in.
+    // Frequency and inverted symbol are packed into one key when they fit,
+    // which sorts several times faster than comparing through `freq`.
+    constexpr unsigned SYMBOL_BITS = 16;
+    constexpr uint64_t SYMBOL_MASK = (uint64_t(1) << SYMBOL_BITS) - 1;
+    if (count <= SYMBOL_MASK + 1 && maxFreq < (uint64_t(1) << (64 - SYMBOL_BITS))) {
+        for (uint64_t& key : order) key = (freq[key] << SYMBOL_BITS) | (SYMBOL_MASK - key);
+        std::sort(order.begin(), order.end());
+        for (uint64_t& key : order) key = SYMBOL_MASK - (key & SYMBOL_MASK);
+    } else {
+        std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+            return freq[a] != freq[b] ? freq[a] < freq[b] : a > b;
+        });
+    }
+    std::vector<uint64_t>& depth = scratch.depth;
+    depth.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) depth[i] = freq[order[i]];
+    treeDepths(depth.data(), depth.size());
+
+    // Count leaves per tree depth; skewed inputs can go up to count - 1 deep.
+    std::vector<unsigned>& depthCount = scratch.depthCount;
+    depthCount.assign(std::max<size_t>(order.size(), maxLen) + 1, 0);
+    unsigned maxDepth = 0;
+    for (uint64_t d : depth) {
+        depthCount[d]++;
+        maxDepth = std::max(maxDepth, static_cast<unsigned>(d));
+    }
+
+    // Limit lengths to maxLen (JPEG Annex K.3): take two leaves off the
+    // deepest level, move one up a level and hang the other with a leaf from
+    // the deepest shorter level, whose slot becomes an internal node. The
+    // Kraft sum stays exactly 1 after each step.
+    for (unsigned i = maxDepth; i > maxLen; --i) {
+        while (depthCount[i] > 0) {
+            unsigned j = i - 2;
+            while (depthCount[j] == 0) --j;
+            depthCount[i] -= 2;
+            depthCount[i - 1] += 1;
+            depthCount[j + 1] += 2;
+            depthCount[j] -= 1;
+        }
+    }
+
+    // Hand out the lengths shortest first in order of decreasing frequency,
+    // so encoder and decoder stay deterministic.
+    size_t next = order.size();
+    for (unsigned len = 1; len <= maxLen; ++len) {
+        for (unsigned k = 0; k < depthCount[len]; ++k) {
+            lengths[order[--next]] = static_cast<uint8_t>(len);
+        }
+    }
+}
+
+Huffman::CodeLengths Huffman::buildCodeLengths(const Histogram& freq) {
+    CodeLengths lengths{};
+    buildLengths(freq.data(), freq.size(), MAX_CODE_LEN, lengths.data());
+    return lengths;
+}
+
+Huffman::CodeLengths Huffman::trainCodeLengths(const Histogram& freq) {
+    // One extra count per byte value keeps unseen bytes codable; they end
+    // up with the longest codes.
+    Histogram smoothed;
+    for (int s = 0; s < 256; ++s) smoothed[s] = freq[s] + 1;
+    return buildCodeLengths(smoothed);
+}
+
+void Huffman::assignCanonicalCodes(const uint8_t* lengths, size_t count, Code* codes) {
+    // Standard canonical assignment: shorter codes first, ties broken by symbol.
+    std::array<uint64_t, 64> lengthCount{};
+    for (size_t s = 0; s < count; ++s) {
+        if (lengths[s]) lengthCount[lengths[s]]++;
+    }
+
+    std::array<uint64_t, 64> nextCode{};
+    uint64_t code = 0;
+    for (unsigned len = 1; len < 64; ++len) {
+        code = (code + lengthCount[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+
+    for (size_t s = 0; s < count; ++s) {
+        uint8_t len = lengths[s];
+        codes[s] = Code{};
+        if (!len) continue;
+        codes[s].bits = nextCode[len]++;
+        codes[s].len = len;
+    }
+}
+
+Huffman::CodeTable Huffman::buildCanonicalCodes(const CodeLengths& lengths) {
+    CodeTable codes{};
+    assignCanonicalCodes(lengths.data(), lengths.size(), codes.data());
+    return codes;
+}
+
+void Huffman::buildDecodeTable(const CodeLengths& lengths, DecodeTable& table) {
+    FC_STAGE(Table);
+    CodeTable codes = buildCanonicalCodes(lengths);
+    const uint32_t tableSize = 1u << LOOKUP_BITS;
+    table.primary.assign(tableSize, DecodeEntry{});
+    table.secondary.clear();
+    table.maxLen = *std::max_element(lengths.begin(), lengths.end());
+
+    // 1. Every short code owns all slots that start with its bits.
+    for (int s = 0; s < 256; ++s) {
+        unsigned len = lengths[s];
+        if (!len || len > LOOKUP_BITS) continue;
+        unsigned shift = LOOKUP_BITS - len;
+        uint32_t first = static_cast<uint32_t>(codes[s].bits) << shift;
+        for (uint32_t i = 0; i < (1u << shift); ++i) {
+            DecodeEntry& e = table.primary[first + i];
+            e.symbols[0] = static_cast<uint8_t>(s);
+            e.count = 1;
+            e.len1 = e.totalLen = static_cast<uint8_t>(len);
+        }
+    }
+
+    // 2. If the bits left over after the first symbol hold a complete second
+    //    code, resolve both symbols with a single lookup.
+    for (uint32_t idx = 0; idx < tableSize; ++idx) {
+        DecodeEntry& e = table.primary[idx];
+        if (e.count != 1) continue;
+        unsigned rest = LOOKUP_BITS - e.len1;
+        if (rest == 0) continue;
+        const DecodeEntry& next = table.primary[(idx << e.len1) & (tableSize - 1)];
+        if (next.count >= 1 && next.len1 <= rest) {
+            e.symbols[1] = next.symbols[0];
+            e.count = 2;
+            e.totalLen = static_cast<uint8_t>(e.len1 + next.len1);
+        }
+    }
+
+    // 3. Long codes: one second-level table per 11-bit prefix, sized for the
+    //    longest code sharing that prefix.
+    std::array<uint8_t, 1 << LOOKUP_BITS> prefixMaxLen{};
+    for (int s = 0; s < 256; ++s) {
+        unsigned len = lengths[s];
+        if (len <= LOOKUP_BITS) continue;
+        uint32_t prefix = static_cast<uint32_t>(codes[s].bits >> (len - LOOKUP_BITS));
+        prefixMaxLen[prefix] = static_cast<uint8_t>(std::max<unsigned>(prefixMaxLen[prefix], len));
+    }
+    for (uint32_t prefix = 0; prefix < tableSize; ++prefix) {
+        if (!prefixMaxLen[prefix]) continue;
+        DecodeEntry& e = table.primary[prefix];
+        unsigned subBits = prefixMaxLen[prefix] - LOOKUP_BITS;
+        e.subBits = static_cast<uint8_t>(subBits);
+        e.subOffset = static_cast<uint32_t>(table.secondary.size());
+        table.secondary.resize(table.secondary.size() + (size_t(1) << subBits));
+    }
+    for (int s = 0; s < 256; ++s) {
+        unsigned len = lengths[s];
+        if (len <= LOOKUP_BITS) continue;
+        unsigned rest = len - LOOKUP_BITS;
+        const DecodeEntry& e = table.primary[codes[s].bits >> rest];
+        unsigned shift = e.subBits - rest;
+        uint32_t first = e.subOffset + (static_cast<uint32_t>(codes[s].bits & ((uint64_t(1) << rest) - 1)) << shift);
+        for (uint32_t i = 0; i < (1u << shift); ++i) {
+            table.secondary[first + i] = SubEntry{static_cast<uint8_t>(s), static_cast<uint8_t>(len)};
+        }
+    }
+}
+
+void Huffman::decodeSymbols(const DecodeTable& table, BitReader& reader, char* out, size_t count) {
+    if (table.maxLen <= LOOKUP_BITS) {
+        decodeSymbolsWith<LOOKUP_BITS>(table, reader, out, count);
+    } else {
+        decodeSymbolsWith<MAX_CODE_LEN>(table, reader, out, count);
+    }
+}
+
+template <unsigned MaxLen>
+void Huffman::decodeSymbolsWith(const DecodeTable& table, BitReader& reader, char* out, size_t count) {
+    // After a refill at least 56 bits are buffered. Each primary lookup
+    // peeks and consumes at most LOOKUP_BITS, and a long code must still
+    // find its MaxLen bits after the lookups before it.
+    constexpr bool LONG_CODES = MaxLen > LOOKUP_BITS;
+    constexpr int LOOKUPS = LONG_CODES ? (56 - MaxLen) / LOOKUP_BITS + 1 : 56 / LOOKUP_BITS;
+    const DecodeEntry* primary = table.primary.data();
+    char* end = out + count;
+    while (out < end) {
+        reader.refill();
+        for (int k = 0; k < LOOKUPS && out < end; ++k) {
+            const DecodeEntry& e = primary[reader.peek(LOOKUP_BITS)];
+            if (e.count == 2 && end - out >= 2) {
+                out[0] = static_cast<char>(e.symbols[0]);
+                out[1] = static_cast<char>(e.symbols[1]);
+                out += 2;
+                reader.consume(e.totalLen);
+            } else if (e.count) {
+                *out++ = static_cast<char>(e.symbols[0]);
+                reader.consume(e.len1);
+            } else if (LONG_CODES && e.subBits) {
+                uint32_t low = static_cast<uint32_t>(reader.peek(LOOKUP_BITS + e.subBits)) & ((1u << e.subBits) - 1);
+                const SubEntry& sub = table.secondary[e.subOffset + low];
+                if (!sub.len) {
+                    throw std::runtime_error("Corrupt Huffman bitstream");
+                }
+                *out++ = static_cast<char>(sub.symbol);
+                reader.consume(sub.len);
+                break;
+            } else {
+                throw std::runtime_error("Corrupt Huffman bitstream");
+            }
+        }
     }
-    buildEncodingTable(root->left, str + "0");
-    buildEncodingTable(root->right, str + "1");
 }
 
 void Huffman::compress(const std::string& inputFile, const std::string& outputFile) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    auto freqMap = buildFrequencyTable(inputFile);
-    std::cout << "DEBUG: Frequency map size = " << freqMap.size() << std::endl;
+    // The whole-file format needs two passes over a mapped input; pipes and
+    // stdin can only be read once and go through the block pipeline instead.
+    InputFile input(inputFile);
+    if (dictionary) {
+        // Dictionary streams are meant for small payloads and coded in memory.
+        std::string data;
+        if (!input.isMapped()) {
+            FC_STAGE(Read);
+            data = readRest(input.stream(), "", 0);
+        }
+        const unsigned char* bytes = input.isMapped() ? input.data() : reinterpret_cast<const unsigned char*>(data.data());
+        size_t size = input.isMapped() ? input.size() : data.size();
+        std::string packed;
+        compressWithDictionary(bytes, size, packed);
+        OutputFile output(outputFile, packed.size());
+        {
+            FC_STAGE(Write);
+            output.stream().write(packed.data(), packed.size());
+            output.close();
+        }
+        FC_COUNT(BytesIn, size);
+        FC_COUNT(BytesOut, packed.size());
 
-    auto root = buildTree(freqMap);
-    buildEncodingTable(root, "");
-    
-    std::ifstream in(inputFile, std::ios::binary);
-    std::string bits;
-    char c;
-    while (in.get(c)) {
-        bits += encodingTable[c];
+        double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        Utils::log() << "✅ [Huffman] Compression complete (dictionary " << Dictionary::formatId(dictionary->id())
+                     << ").\n";
+        Utils::log() << "Input: " << size << " bytes | Output: " << packed.size() << " bytes | Time: " << timeTaken
+                     << "s\n";
+        return;
     }
-    in.close();
+    if (!input.isMapped()) {
+        OutputFile output(outputFile);
+        compressBlocks(input.stream(), output.stream(), 1);
+        output.close();
+        return;
+    }
+    const unsigned char* data = input.data();
+    size_t size = input.size();
+
+    int numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    StreamPlan plan = planStream(buildFrequencyTable(data, size, numThreads), size);
+    uint64_t inSize = size;
 
-    std::cout << "DEBUG: Bits length = " << bits.size() << std::endl;
-    std::cout << "DEBUG: Attempting to write " << outputFile << std::endl;
+    // The exact payload size is known up front from the histogram, so the
+    // file can be presized and mapped.
+    uint64_t outSize = plan.header.size() + (plan.bitLen + CHECKSUM_BITS + 7) / 8;
+    OutputFile output(outputFile, outSize);
+    std::ostream& out = output.stream();
 
-    writeBitstream(bits, outputFile, freqMap);
+    out.write(plan.header.data(), plan.header.size());
+
+    // --- COMPRESSED DATA ---
+    BitWriter writer(out);
+    writer.write(encodeSymbols(plan.codes, data, size, writer), CHECKSUM_BITS);
+    writer.flush();
+    {
+        FC_STAGE(Write);
+        output.close();
+    }
+    FC_COUNT(BytesIn, inSize);
+    FC_COUNT(BytesOut, outSize);
 
     auto end = std::chrono::high_resolution_clock::now();
     double timeTaken = std::chrono::duration<double>(end - start).count();
-    auto inSize = std::filesystem::file_size(inputFile);
-    auto outSize = std::filesystem::file_size(outputFile);
     double ratio = (1.0 - (double)outSize / inSize) * 100.0;
-    std::cout << "✅ [Huffman] Compression complete.\n";
-    std::cout << "Input: " << inSize << " bytes | Output: " << outSize << " bytes | ";
-    std::cout << "Ratio: " << ratio << "% | Time: " << timeTaken << "s\n"; 
+    double throughput = timeTaken > 0 ? (inSize / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Huffman] Compression complete.\n";
+    Utils::log() << "Input: " << inSize << " bytes | Output: " << outSize << " bytes | ";
+    Utils::log() << "Ratio: " << ratio << "% | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
 }
 
-void Huffman::compressMultiThreaded(const std::string& inputFile, const std::string& outputFile, int numThreads) {
-    using namespace std::chrono;
-
-    auto start = high_resolution_clock::now();
-    std::ifstream in(inputFile, std::ios::binary);
-    if(!in.is_open()){
-        throw std::runtime_error("Could not open input file: " + inputFile);
+void Huffman::encodeBlock(const char* data, size_t size, std::string& frame) {
+    Histogram freq = buildFrequencyTable(reinterpret_cast<const unsigned char*>(data), size);
+    CodeLengths lengths;
+    CodeTable codes;
+    {
+        FC_STAGE(Table);
+        lengths = buildCodeLengths(freq);
+        codes = buildCanonicalCodes(lengths);
     }
-    std::vector<std::string> chunks(numThreads);
-    std::uintmax_t fileSize = std::filesystem::file_size(inputFile);
-    std::uintmax_t chunkSize = fileSize / numThreads;
 
-    // Read file in chunks
-    for(int i = 0; i < numThreads; ++i) {
-        std::string data(chunkSize, '\0');
-        in.read(&data[0], chunkSize);
-        chunks[i] = std::move(data);
+    uint64_t bitLen = 0;
+    uint16_t symbolCount = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (!freq[s]) continue;
+        bitLen += freq[s] * codes[s].len;
+        symbolCount++;
     }
-    in.close();
+    uint32_t payloadSize = static_cast<uint32_t>((bitLen + 7) / 8);
 
-    std::mutex outputMutex;
-    std::vector<std::string>compressedChunks(numThreads);
+    frame.clear();
+    frame.reserve(22 + codeTableSize(symbolCount) + payloadSize);
+    appendField<uint32_t>(frame, static_cast<uint32_t>(size));
+    appendField<uint32_t>(frame, payloadSize);
+    appendField<uint32_t>(frame, 0);    // checksum, filled in once coded
+    appendField<uint64_t>(frame, bitLen);
+    appendField<uint16_t>(frame, symbolCount);
+    appendCodeLengths(frame, lengths, symbolCount);
 
-    auto worker =[&](int idx){
-        std::unordered_map<char, int> freq;
-        for(char c : chunks[idx]) freq[c]++;
-        auto root = buildTree(freq);
-        buildEncodingTable(root, "");
+    BitWriter writer(frame, std::min<size_t>(IO_BUFFER_SIZE, payloadSize + 8));
+    uint32_t crc = encodeSymbols(codes, reinterpret_cast<const unsigned char*>(data), size, writer);
+    writer.flush();
+    std::memcpy(&frame[2 * sizeof(uint32_t)], &crc, sizeof(crc));
+    FC_COUNT(BytesIn, size);
+    FC_COUNT(BytesOut, frame.size());
+    FC_COUNT(Blocks, 1);
+}
 
-        std::string bits;
-        for(char c : chunks[idx]) bits += encodingTable[c];
+void Huffman::decodeBlock(const char* frame, size_t frameSize, std::string& out) {
+    const char* p = frame;
+    const char* end = frame + frameSize;
+    uint32_t rawSize = readField<uint32_t>(p, end);
+    uint32_t payloadSize = readField<uint32_t>(p, end);
+    uint32_t crc = readField<uint32_t>(p, end);
+    uint64_t bitLen = readField<uint64_t>(p, end);
+    uint16_t symbolCount = readField<uint16_t>(p, end);
+    // Every symbol takes at least one bit, so bitLen bounds rawSize before
+    // the output is sized for it.
+    if (symbolCount > 256 || (bitLen + 7) / 8 != payloadSize || rawSize > bitLen) {
+        throw std::runtime_error("Corrupt Huffman block: bad frame header");
+    }
 
-        //Protect shared vector
-        std::lock_guard<std::mutex> lock(outputMutex);
-        compressedChunks[idx] = std::move(bits);
-    };
+    CodeLengths lengths = parseCodeLengths(p, end, symbolCount);
+    p += codeTableSize(symbolCount);
+    if (static_cast<size_t>(end - p) < payloadSize) {
+        throw std::runtime_error("Corrupt Huffman block: truncated payload");
+    }
 
-    std::vector<std::thread> threads;
-    for(int i = 0; i < numThreads; ++i){
-        threads.emplace_back(worker, i);
-    }
-    for(auto& t : threads) t.join();
-
-    //merge compressed bitstreams
-    std::ofstream out(outputFile, std::ios::binary);
-    for(auto& chunkBits : compressedChunks){
-        unsigned char buffer = 0;
-        int bitCount = 0;
-        for(char b: chunkBits){
-            buffer <<= 1;
-            if(b == '1') buffer |= 1;
-            bitCount++;
-            if(bitCount == 8){
-                out.write(reinterpret_cast<char*>(&buffer), 1);
-                buffer = 0;
-                bitCount = 0;
-            }
+    out.resize(rawSize);
+    if (rawSize == 0) {
+        if (crc != Crc32c().value()) throw std::runtime_error("Huffman block checksum mismatch");
+        return;
+    }
+    // One table per thread, rebuilt in place, so each block reuses the
+    // storage of the last one instead of allocating its own.
+    thread_local DecodeTable table;
+    buildDecodeTable(lengths, table);
+    {
+        FC_STAGE(Decode);
+        BitReader reader(reinterpret_cast<const unsigned char*>(p), payloadSize);
+        decodeSymbols(table, reader, &out[0], rawSize);
+        if (reader.overrun()) {
+            throw std::runtime_error("Corrupt Huffman block: payload shorter than its symbols");
         }
-        if(bitCount > 0){
-            buffer <<= (8 - bitCount);
-            out.write(reinterpret_cast<char*>(&buffer), 1);
+        if (Crc32c::compute(out.data(), rawSize) != crc) {
+            throw std::runtime_error("Huffman block checksum mismatch");
         }
     }
-    out.close();
+    FC_COUNT(BytesIn, frameSize);
+    FC_COUNT(BytesOut, rawSize);
+    FC_COUNT(Blocks, 1);
+}
+
+bool Huffman::readFrame(std::istream& in, uint32_t blockSize, std::string& frame) {
+    uint32_t rawSize = 0;
+    in.read(reinterpret_cast<char*>(&rawSize), sizeof(rawSize));
+    if (!in) {
+        throw std::runtime_error("Truncated Huffman block container");
+    }
+    if (rawSize == 0) return false;
+    if (rawSize > blockSize) {
+        throw std::runtime_error("Corrupt Huffman block: larger than the container's block size");
+    }
+
+    // Fixed part of the frame header, then the code table, then the payload.
+    constexpr size_t fixedSize = sizeof(uint32_t) * 3 + sizeof(uint64_t) + sizeof(uint16_t);
+    frame.resize(fixedSize);
+    std::memcpy(&frame[0], &rawSize, sizeof(rawSize));
+    in.read(&frame[sizeof(rawSize)], fixedSize - sizeof(rawSize));
+    uint32_t payloadSize;
+    uint16_t symbolCount;
+    std::memcpy(&payloadSize, &frame[sizeof(uint32_t)], sizeof(payloadSize));
+    std::memcpy(&symbolCount, &frame[fixedSize - sizeof(uint16_t)], sizeof(symbolCount));
+    if (!in || symbolCount > 256) {
+        throw std::runtime_error("Corrupt Huffman block: bad frame header");
+    }
+    size_t rest = codeTableSize(symbolCount) + payloadSize;
+    if (payloadSize > (uint64_t(rawSize) * MAX_CODE_LEN + 7) / 8 + codeTableSize(symbolCount)) {
+        throw std::runtime_error("Corrupt Huffman block: payload larger than its symbols can code to");
+    }
+    frame.resize(fixedSize + rest);
+    in.read(&frame[fixedSize], rest);
+    if (!in) {
+        throw std::runtime_error("Truncated Huffman block container");
+    }
+    return true;
+}
+
+void Huffman::compressMultiThreaded(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    InputFile input(inputFile, InputFile::Access::Streamed);
+    OutputFile output(outputFile);
+    compressBlocks(input.stream(), output.stream(), numThreads);
+    output.close();
+}
+
+void Huffman::compressBlocks(std::istream& in, std::ostream& out, int numThreads) {
+    using namespace std::chrono;
+
+    auto start = high_resolution_clock::now();
+
+    out.write(BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    out.write(reinterpret_cast<const char*>(&BLOCK_VERSION), sizeof(BLOCK_VERSION));
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    out.write(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
+
+    // Reader -> workers -> ordered writer. Each block owns its code table and
+    // output frame, so workers share no state; only `window` blocks are held
+    // in memory at once (input plus a frame of up to the same size).
+    std::vector<BlockIndexEntry> index;
+    uint64_t frameOffset = sizeof(BLOCK_MAGIC) + sizeof(BLOCK_VERSION) + sizeof(blockSize);
+    uint64_t rawOffset = 0;
+    uint32_t streamCrc = Crc32c().value();
+
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& block) {
+            FC_STAGE(Read);
+            block.resize(blockSize);
+            in.read(&block[0], blockSize);
+            block.resize(static_cast<size_t>(in.gcount()));
+            if (in.bad()) {
+                throw std::runtime_error("Could not read input");
+            }
+            return !block.empty();
+        },
+        [](const std::string& block, std::string& frame) {
+            encodeBlock(block.data(), block.size(), frame);
+        },
+        [&](const std::string& frame) {
+            FC_STAGE(Write);
+            uint32_t rawSize, crc;
+            std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+            std::memcpy(&crc, frame.data() + 2 * sizeof(uint32_t), sizeof(crc));
+            streamCrc = Crc32c::combine(streamCrc, crc, rawSize);
+            index.push_back({rawOffset, frameOffset});
+            out.write(frame.data(), frame.size());
+            frameOffset += frame.size();
+            rawOffset += rawSize;
+        });
+
+    uint32_t terminator = 0;
+    out.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator));
+    out.write(reinterpret_cast<const char*>(&streamCrc), sizeof(streamCrc));
+
+    uint64_t indexOffset = frameOffset + sizeof(terminator) + sizeof(streamCrc);
+    uint32_t indexCount = static_cast<uint32_t>(index.size());
+    out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+    for (auto& entry : index) {
+        out.write(reinterpret_cast<const char*>(&entry.rawOffset), sizeof(entry.rawOffset));
+        out.write(reinterpret_cast<const char*>(&entry.frameOffset), sizeof(entry.frameOffset));
+    }
+    out.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    out.flush();
 
     auto end = high_resolution_clock::now();
     double timeTaken = duration<double>(end - start).count();
 
-    auto outSize = std::filesystem::file_size(outputFile);
-    double ratio = (1.0 - (double)outSize / fileSize) * 100.0;
+    uint64_t outSize = indexOffset + sizeof(indexCount) + index.size() * 2 * sizeof(uint64_t)
+                       + sizeof(indexOffset) + sizeof(INDEX_MAGIC);
+    double ratio = (1.0 - (double)outSize / rawOffset) * 100.0;
+    double throughput = timeTaken > 0 ? (rawOffset / (1024.0 * 1024.0)) / timeTaken : 0.0;
 
-    std::cout << "✅ [Huffman Multi-threaded] Compression complete.\n";
-    std::cout << "Threads: " << numThreads << " | Input: " << fileSize
-              << " bytes | "<< "Output: " << outSize << " bytes | Ratio: " << ratio << "% | Time: " << timeTaken << "s\n";
+    Utils::log() << "✅ [Huffman Multi-threaded] Compression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << index.size() << " | Window: " << window
+                 << " | Input: " << rawOffset << " bytes | "<< "Output: " << outSize << " bytes | Ratio: " << ratio
+                 << "% | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
 }
 
-void Huffman::decompress(const std::string& inputFile, const std::string& outputFile) {
+void Huffman::decompressBlocks(std::istream& in, std::ostream& out, int numThreads) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::ifstream in(inputFile, std::ios::binary);
-    if(!in.is_open()){
-        throw std::runtime_error("Could not open input file: " + inputFile);
+    // The magic number has already been consumed by decompress().
+    uint8_t version = 0;
+    uint32_t blockSize = 0;
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+    if (!in || version != BLOCK_VERSION) {
+        throw std::runtime_error("Unsupported Huffman block container version");
     }
-    // --- READ HEADER ---
-    int uniqueCount;
-    in.read(reinterpret_cast<char*>(&uniqueCount), sizeof(uniqueCount));
-
-    std::unordered_map<char, int> freqMap;
-    for (int i = 0; i < uniqueCount; ++i) {
-        char ch;
-        int freq;
-        in.read(&ch, sizeof(char));
-        in.read(reinterpret_cast<char*>(&freq), sizeof(int));
-        freqMap[ch] = freq;
-    }
-
-    // Read bit length
-    int bitLen = 0;
-    in.read(reinterpret_cast<char*>(&bitLen), sizeof(bitLen));
-
-    // --- REBUILD TREE ---
-    std::shared_ptr<Node> root = buildTree(freqMap);
-
-    // --- READ BITSTREAM ---
-    std::string bits;
-    char byte;
-    while (in.read(&byte, 1)) {
-        for(int i=7; i>=0; --i){
-            bits += ((byte >> i) & 1) ? '1' : '0';
-        }
+
+    // Frames are read sequentially, so this works on pipes as well as files;
+    // the trailing index is only checked against them once they are decoded.
+    uint64_t inSize = sizeof(BLOCK_MAGIC) + sizeof(version) + sizeof(blockSize);
+    uint64_t outSize = 0;
+    uint64_t blockCount = 0;
+    uint32_t streamCrc = Crc32c().value();
+    BlockPipeline::BlockIndex index;
+    uint64_t rawOffset = 0;
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& frame) {
+            FC_STAGE(Read);
+            if (!readFrame(in, blockSize, frame)) return false;
+            // Each block's checksum is verified by decodeBlock; chaining
+            // them also catches blocks that are missing or out of order.
+            uint32_t rawSize, crc;
+            std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+            std::memcpy(&crc, frame.data() + 2 * sizeof(uint32_t), sizeof(crc));
+            streamCrc = Crc32c::combine(streamCrc, crc, rawSize);
+            index.emplace_back(rawOffset, inSize);
+            rawOffset += rawSize;
+            inSize += frame.size();
+            return true;
+        },
+        [](const std::string& frame, std::string& block) {
+            decodeBlock(frame.data(), frame.size(), block);
+        },
+        [&](const std::string& block) {
+            FC_STAGE(Write);
+            out.write(block.data(), block.size());
+            outSize += block.size();
+            blockCount++;
+        });
+
+    uint32_t storedCrc = 0;
+    in.read(reinterpret_cast<char*>(&storedCrc), sizeof(storedCrc));
+    if (!in || storedCrc != streamCrc) {
+        throw std::runtime_error("Huffman stream checksum mismatch");
     }
-    in.close();
+    inSize += 2 * sizeof(uint32_t);
+    BlockPipeline::checkIndex(in, index, inSize, INDEX_MAGIC);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double timeTaken = std::chrono::duration<double>(end - start).count();
+
+    double throughput = timeTaken > 0 ? (outSize / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [Huffman Multi-threaded] Decompression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << blockCount << " | Window: " << window
+                 << " | Input: " << inSize << " bytes | Output: " << outSize << " bytes | Time: " << timeTaken
+                 << "s | Throughput: " << throughput << " MB/s\n";
+}
 
-    // Trim bits to valid length
-    if(bitLen < bits.size()){
-        bits.resize(bitLen);
+void Huffman::decompress(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    InputFile input(inputFile);
+    std::istream& in = input.stream();
+
+    // Both formats start with a magic number. Input may be a pipe, so the
+    // four bytes are reused rather than re-read.
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    if (!in) {
+        throw std::runtime_error("Corrupt Huffman header: " + inputFile);
+    }
+    if (std::memcmp(magic, BLOCK_MAGIC, sizeof(magic)) == 0) {
+        OutputFile output(outputFile);
+        decompressBlocks(in, output.stream(), numThreads);
+        output.close();
+        return;
     }
+    if (std::memcmp(magic, DICT_STREAM_MAGIC, sizeof(magic)) == 0) {
+        std::string packed, data;
+        {
+            FC_STAGE(Read);
+            packed = readRest(in, magic, sizeof(magic));
+        }
+        decompressWithDictionary(reinterpret_cast<const unsigned char*>(packed.data()), packed.size(), data);
+        {
+            FC_STAGE(Write);
+            OutputFile output(outputFile, data.size());
+            output.stream().write(data.data(), data.size());
+            output.close();
+        }
+        FC_COUNT(BytesIn, packed.size());
+        FC_COUNT(BytesOut, data.size());
 
-    // --- DECODE ---
-    std::ofstream out(outputFile);
-    if(!out.is_open()){
-        throw std::runtime_error("Could not open output file: " + outputFile);
+        double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        Utils::log() << "✅ [Huffman] Decompression complete.\n";
+        Utils::log() << "Input: " << packed.size() << " bytes | Output: " << data.size() << " bytes | Time: "
+                     << timeTaken << "s\n";
+        return;
+    }
+    if (std::memcmp(magic, STREAM_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a Huffman compressed file: " + inputFile);
+    }
+
+    // --- READ HEADER ---
+    std::string headerBytes(magic, sizeof(magic));
+    headerBytes.resize(STREAM_FIXED_SIZE);
+    in.read(&headerBytes[sizeof(magic)], STREAM_FIXED_SIZE - sizeof(magic));
+    uint16_t tableSymbols = 0;
+    std::memcpy(&tableSymbols, &headerBytes[STREAM_FIXED_SIZE - sizeof(tableSymbols)], sizeof(tableSymbols));
+    if (!in || tableSymbols > 256) {
+        throw std::runtime_error("Corrupt Huffman header: " + inputFile);
+    }
+    headerBytes.resize(STREAM_FIXED_SIZE + codeTableSize(tableSymbols));
+    in.read(&headerBytes[STREAM_FIXED_SIZE], headerBytes.size() - STREAM_FIXED_SIZE);
+    if (!in) {
+        throw std::runtime_error("Corrupt Huffman header: " + inputFile);
+    }
+    StreamHeader header = parseStreamHeader(headerBytes.data(), headerBytes.data() + headerBytes.size());
+    // Every symbol takes at least one bit, and a mapped file must hold the
+    // whole payload, so a forged rawSize cannot presize a huge output.
+    if (header.rawSize > header.bitLen
+        || (input.isMapped() && header.size + (header.bitLen + CHECKSUM_BITS + 7) / 8 > input.size())) {
+        throw std::runtime_error("Truncated Huffman bitstream: " + inputFile);
     }
 
-    std::shared_ptr<Node> current = root;
-    for (char bit : bits) {
-        if (bit == '0') current = current->left;
-        else current = current->right;
+    // --- REBUILD DECODE TABLES ---
+    buildDecodeTable(header.lengths, decodeTable);
 
-        if (current->left == nullptr && current->right == nullptr) {
-            out.put(current->ch);
-            current = root;
+    // --- DECODE ---
+    // Mapped input is decoded in place; its restored size has been checked
+    // against the payload, so the output is presized and mapped as well.
+    BitReader reader = input.isMapped()
+        ? BitReader(input.data() + header.size, input.size() - header.size)
+        : BitReader(in);
+    OutputFile output(outputFile, input.isMapped() ? header.rawSize : OutputFile::UNKNOWN_SIZE);
+    std::ostream& out = output.stream();
+    std::vector<char> outBuffer(DECODE_BUFFER_SIZE);
+    uint64_t remaining = header.rawSize;
+    Crc32c crc;
+    while (remaining > 0) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, outBuffer.size()));
+        {
+            FC_STAGE(Decode);
+            decodeSymbols(decodeTable, reader, outBuffer.data(), n);
+            crc.update(outBuffer.data(), n);
+        }
+        // Missing bits read as zero, so stop at the first chunk that ran
+        // past the end of the stream rather than after rawSize symbols.
+        if (reader.overrun()) {
+            throw std::runtime_error("Truncated Huffman bitstream: " + inputFile);
         }
+        FC_STAGE(Write);
+        out.write(outBuffer.data(), n);
+        remaining -= n;
+    }
+    reader.refill();
+    uint32_t storedCrc = static_cast<uint32_t>(reader.peek(CHECKSUM_BITS));
+    reader.consume(CHECKSUM_BITS);
+    if (reader.overrun()) {
+        throw std::runtime_error("Truncated Huffman bitstream: " + inputFile);
+    }
+    if (storedCrc != crc.value()) {
+        throw std::runtime_error("Huffman checksum mismatch: " + inputFile);
+    }
+    {
+        FC_STAGE(Write);
+        output.close();
     }
-    out.close();
 
     auto end = std::chrono::high_resolution_clock::now();
     double timeTaken = std::chrono::duration<double>(end - start).count();
 
-    auto inSize = std::filesystem::file_size(inputFile);
-    auto outSize = std::filesystem::file_size(outputFile);
-    std::cout << "✅ [Huffman] Decompression complete.\n";
-    std::cout << "Input: " << inSize << " bytes | Output: " << outSize << " bytes | ";
-    std::cout << "Time: " << timeTaken << "s\n";
-}
\ No newline at end of file
+    uint64_t inSize = header.size + (header.bitLen + CHECKSUM_BITS + 7) / 8;
+    FC_COUNT(BytesIn, inSize);
+    FC_COUNT(BytesOut, header.rawSize);
+    Utils::log() << "✅ [Huffman] Decompression complete.\n";
+    Utils::log() << "Input: " << inSize << " bytes | Output: " << header.rawSize << " bytes | ";
+    Utils::log() << "Time: " << timeTaken << "s\n";
+}
+
+void Huffman::compressBuffer(const unsigned char* data, size_t size, std::string& out) {
+    if (dictionary) {
+        compressWithDictionary(data, size, out);
+        return;
+    }
+    StreamPlan plan = planStream(buildFrequencyTable(data, size), size);
+    size_t payloadSize = static_cast<size_t>((plan.bitLen + CHECKSUM_BITS + 7) / 8);
+    out.clear();
+    out.reserve(plan.header.size() + payloadSize);
+    out += plan.header;
+    BitWriter writer(out, std::min<size_t>(IO_BUFFER_SIZE, payloadSize + 8));
+    writer.write(encodeSymbols(plan.codes, data, size, writer), CHECKSUM_BITS);
+    writer.flush();
+}
+
+void Huffman::decompressBuffer(const unsigned char* data, size_t size, std::string& out) {
+    if (size >= sizeof(DICT_STREAM_MAGIC) && std::memcmp(data, DICT_STREAM_MAGIC, sizeof(DICT_STREAM_MAGIC)) == 0) {
+        decompressWithDictionary(data, size, out);
+        return;
+    }
+    const char* begin = reinterpret_cast<const char*>(data);
+    StreamHeader header = parseStreamHeader(begin, begin + size);
+    size_t payloadSize = size - header.size;
+    // Every symbol takes at least one bit.
+    if ((header.bitLen + CHECKSUM_BITS + 7) / 8 > payloadSize || header.rawSize > header.bitLen) {
+        throw std::runtime_error("Truncated Huffman bitstream");
+    }
+
+    out.resize(static_cast<size_t>(header.rawSize));
+    if (!out.empty()) buildDecodeTable(header.lengths, decodeTable);
+    FC_STAGE(Decode);
+    BitReader reader(data + header.size, payloadSize);
+    if (!out.empty()) {
+        decodeSymbols(decodeTable, reader, &out[0], out.size());
+    }
+    reader.refill();
+    uint32_t storedCrc = static_cast<uint32_t>(reader.peek(CHECKSUM_BITS));
+    reader.consume(CHECKSUM_BITS);
+    if (reader.overrun()) {
+        throw std::runtime_error("Truncated Huffman bitstream");
+    }
+    if (storedCrc != Crc32c::compute(out.data(), out.size())) {
+        throw std::runtime_error("Huffman checksum mismatch");
+    }
+}
+
+void Huffman::setDictionary(std::shared_ptr<const Dictionary> dict) {
+    if (dict) prepareDictionaryTables(*dict);
+    dictionary = std::move(dict);
+}
+
+void Huffman::prepareDictionaryTables(const Dictionary& dict) {
+    if (dictTablesReady && dictTablesId == dict.id()) return;
+    dictTablesReady = false;
+    CodeLengths lengths = dict.huffmanLengths();
+    uint64_t kraft = 0;
+    for (uint8_t len : lengths) {
+        if (len == 0 || len > MAX_CODE_LEN) {
+            throw std::runtime_error("Corrupt dictionary: bad Huffman code lengths");
+        }
+        kraft += uint64_t(1) << (MAX_CODE_LEN - len);
+    }
+    if (kraft > (uint64_t(1) << MAX_CODE_LEN)) {
+        throw std::runtime_error("Corrupt dictionary: bad Huffman code lengths");
+    }
+    dictCodes = buildCanonicalCodes(lengths);
+    buildDecodeTable(lengths, dictDecodeTable);
+    dictTablesId = dict.id();
+    dictTablesReady = true;
+}
+
+void Huffman::compressWithDictionary(const unsigned char* data, size_t size, std::string& out) {
+    prepareDictionaryTables(*dictionary);
+    out.assign(DICT_STREAM_MAGIC, sizeof(DICT_STREAM_MAGIC));
+    appendField<uint8_t>(out, DICT_STREAM_VERSION);
+    appendField<uint32_t>(out, dictionary->id());
+    appendVarint(out, size);
+    BitWriter writer(out, std::min<size_t>(IO_BUFFER_SIZE, size + 16));
+    writer.write(encodeSymbols(dictCodes, data, size, writer), CHECKSUM_BITS);
+    writer.flush();
+}
+
+void Huffman::decompressWithDictionary(const unsigned char* data, size_t size, std::string& out) {
+    const char* p = reinterpret_cast<const char*>(data) + sizeof(DICT_STREAM_MAGIC);
+    const char* end = reinterpret_cast<const char*>(data) + size;
+    if (readField<uint8_t>(p, end) != DICT_STREAM_VERSION) {
+        throw std::runtime_error("Unsupported Huffman dictionary stream version");
+    }
+    uint32_t id = readField<uint32_t>(p, end);
+    uint64_t rawSize = readVarint(p, end);
+    size_t payloadSize = static_cast<size_t>(end - p);
+    // Every symbol takes at least one bit.
+    if (rawSize > uint64_t(payloadSize) * 8) {
+        throw std::runtime_error("Truncated Huffman bitstream");
+    }
+
+    if (dictionary && dictionary->id() == id) {
+        prepareDictionaryTables(*dictionary);
+    } else {
+        loadedDictionary = Dictionary::resolve(loadedDictionary, dictionaryDir, id);
+        prepareDictionaryTables(*loadedDictionary);
+    }
+
+    out.resize(static_cast<size_t>(rawSize));
+    FC_STAGE(Decode);
+    BitReader reader(reinterpret_cast<const unsigned char*>(p), payloadSize);
+    if (!out.empty()) {
+        decodeSymbols(dictDecodeTable, reader, &out[0], out.size());
+    }
+    reader.refill();
+    uint32_t storedCrc = static_cast<uint32_t>(reader.peek(CHECKSUM_BITS));
+    reader.consume(CHECKSUM_BITS);
+    if (reader.overrun()) {
+        throw std::runtime_error("Truncated Huffman bitstream");
+    }
+    if (storedCrc != Crc32c::compute(out.data(), out.size())) {
+        throw std::runtime_error("Huffman checksum mismatch");
+    }
+}
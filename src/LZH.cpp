@@ -0,0 +1,642 @@
+#include "LZH.hpp"
+#include "BitIO.hpp"
+#include "Checksum.hpp"
+#include "FileIO.hpp"
+#include "Huffman.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr unsigned HASH_BITS = 15;
+    // Candidates tried per position, and the length at which a match is taken
+    // without looking further.
+    constexpr unsigned MAX_CHAIN = 32;
+    constexpr unsigned NICE_LENGTH = 128;
+    // Matches shorter than this are checked against a match one byte later.
+    constexpr unsigned LAZY_LIMIT = 32;
+    // Code length tables: nibble 15 plus 5 bits stands for 3-34 zero lengths.
+    constexpr unsigned ZERO_RUN = 15;
+    constexpr unsigned ZERO_RUN_BITS = 5;
+    constexpr unsigned MIN_ZERO_RUN = 3;
+    constexpr uint32_t MATCH_FLAG = 0x80000000u;
+    // Input is checksummed this far ahead of the match finder; larger than
+    // the longest match, so one slice per step always keeps it ahead.
+    constexpr size_t CHECKSUM_SLICE = 1 << 16;
+
+    struct DecodeEntry {
+        uint16_t symbol = 0;
+        uint8_t len = 0;      // 0: no code has this prefix
+    };
+
+    inline uint32_t load32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t hash4(const unsigned char* p) {
+        return (load32(p) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    inline unsigned highBit(uint32_t v) {
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(v);
+#else
+        unsigned n = 0;
+        while (v >>= 1) ++n;
+        return n;
+#endif
+    }
+
+    // Length of the common prefix of a and b, at most `limit`; compares eight
+    // bytes at a time (little-endian loads, so the first difference is the
+    // lowest set bit of the XOR).
+    inline unsigned matchLength(const unsigned char* a, const unsigned char* b, unsigned limit) {
+        unsigned len = 0;
+        while (len + 8 <= limit) {
+            uint64_t x, y;
+            std::memcpy(&x, a + len, sizeof(x));
+            std::memcpy(&y, b + len, sizeof(y));
+            if (uint64_t diff = x ^ y) {
+#if defined(__GNUC__)
+                return len + (__builtin_ctzll(diff) >> 3);
+#else
+                while (!(diff & 0xFF)) { diff >>= 8; ++len; }
+                return len;
+#endif
+            }
+            len += 8;
+        }
+        while (len < limit && a[len] == b[len]) ++len;
+        return len;
+    }
+
+    // Length and distance buckets: small values are their own bucket, larger
+    // ones keep their top two bits in the bucket and send the rest raw.
+    struct Bucket {
+        unsigned code;
+        unsigned extraBits;
+        uint32_t extra;
+    };
+
+    inline Bucket bucketOf(uint32_t value) {
+        if (value < 16) return {value, 0, 0};
+        unsigned n = highBit(value);
+        return {16 + 2 * (n - 4) + ((value >> (n - 1)) & 1), n - 1, value & ((uint32_t(1) << (n - 1)) - 1)};
+    }
+
+    inline uint32_t readBucket(BitReader& reader, unsigned code) {
+        if (code < 16) return code;
+        unsigned k = code - 16;
+        unsigned n = k / 2 + 4;
+        uint32_t value = ((2u | (k & 1)) << (n - 1)) + static_cast<uint32_t>(reader.peek(n - 1));
+        reader.consume(n - 1);
+        return value;
+    }
+
+    void writeLengths(BitWriter& writer, const uint8_t* lengths, size_t count) {
+        for (size_t i = 0; i < count;) {
+            size_t run = 0;
+            while (i + run < count && lengths[i + run] == 0 && run < MIN_ZERO_RUN + (1u << ZERO_RUN_BITS) - 1) {
+                ++run;
+            }
+            if (run >= MIN_ZERO_RUN) {
+                writer.write(ZERO_RUN, 4);
+                writer.write(run - MIN_ZERO_RUN, ZERO_RUN_BITS);
+                i += run;
+            } else {
+                writer.write(lengths[i++], 4);
+            }
+        }
+    }
+
+    void readLengths(BitReader& reader, uint8_t* lengths, size_t count, unsigned maxLen) {
+        for (size_t i = 0; i < count;) {
+            reader.refill();
+            unsigned len = static_cast<unsigned>(reader.peek(4));
+            reader.consume(4);
+            if (len == ZERO_RUN) {
+                size_t run = MIN_ZERO_RUN + static_cast<size_t>(reader.peek(ZERO_RUN_BITS));
+                reader.consume(ZERO_RUN_BITS);
+                if (run > count - i) {
+                    throw std::runtime_error("Corrupt LZH stream: bad code length table");
+                }
+                std::fill(lengths + i, lengths + i + run, 0);
+                i += run;
+            } else if (len > maxLen) {
+                throw std::runtime_error("Corrupt LZH stream: bad code length table");
+            } else {
+                lengths[i++] = static_cast<uint8_t>(len);
+            }
+        }
+        if (reader.overrun()) {
+            throw std::runtime_error("Truncated LZH stream");
+        }
+    }
+
+    // Flat single-level table indexed by the next `bits` bits. Codes must be
+    // complete (Kraft sum exactly 1), except for the lone 1-bit code of a
+    // single-symbol alphabet and for an unused alphabet.
+    void buildDecodeTable(const uint8_t* lengths, size_t count, unsigned bits, DecodeEntry* table) {
+        uint64_t kraft = 0;
+        size_t used = 0;
+        for (size_t s = 0; s < count; ++s) {
+            if (lengths[s]) {
+                kraft += uint64_t(1) << (bits - lengths[s]);
+                ++used;
+            }
+        }
+        if (kraft > (uint64_t(1) << bits) || (used > 1 && kraft != (uint64_t(1) << bits))) {
+            throw std::runtime_error("Corrupt LZH stream: invalid code lengths");
+        }
+
+        std::vector<Huffman::Code> codes(count);
+        Huffman::assignCanonicalCodes(lengths, count, codes.data());
+        std::fill(table, table + (size_t(1) << bits), DecodeEntry{});
+        for (size_t s = 0; s < count; ++s) {
+            if (!codes[s].len) continue;
+            unsigned fill = bits - codes[s].len;
+            size_t start = static_cast<size_t>(codes[s].bits) << fill;
+            std::fill(table + start, table + start + (size_t(1) << fill),
+                      DecodeEntry{static_cast<uint16_t>(s), codes[s].len});
+        }
+    }
+
+    template <typename T>
+    void appendField(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readField(const unsigned char* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+}
+
+struct LZH::Workspace {
+    // Hash chains hold position + 1 (0 = empty) so only `head` needs
+    // clearing per call; `prev` is only followed for positions inserted by
+    // the current call.
+    std::vector<uint32_t> head = std::vector<uint32_t>(size_t(1) << HASH_BITS);
+    std::vector<uint32_t> prev = std::vector<uint32_t>(WINDOW_SIZE);
+    // Literal byte, or MATCH_FLAG | (length - MIN_MATCH) << 16 | (distance - 1).
+    std::vector<uint32_t> tokens;
+
+    std::array<uint8_t, LITLEN_CODES> litLenLengths{};
+    std::array<uint8_t, DIST_CODES> distLengths{};
+    std::array<DecodeEntry, size_t(1) << MAX_CODE_LEN> litLenTable{};
+    std::array<DecodeEntry, size_t(1) << MAX_CODE_LEN> distTable{};
+
+    inline void insert(const unsigned char* data, size_t pos) {
+        uint32_t& slot = head[hash4(data + pos)];
+        prev[pos & (WINDOW_SIZE - 1)] = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+    }
+
+    // Longest match for `pos` in the window, 0 if none reaches MIN_MATCH.
+    inline unsigned findMatch(const unsigned char* data, size_t size, size_t pos, uint32_t& distance) const {
+        unsigned limit = static_cast<unsigned>(std::min<size_t>(MAX_MATCH, size - pos));
+        unsigned best = MIN_MATCH - 1;
+        uint32_t self = static_cast<uint32_t>(pos + 1);
+        uint32_t candidate = head[hash4(data + pos)];
+        for (unsigned depth = 0; depth < MAX_CHAIN && candidate; ++depth) {
+            uint32_t dist = self - candidate;
+            if (dist == 0 || dist > WINDOW_SIZE || dist > pos) break;
+            const unsigned char* match = data + pos - dist;
+            if (match[best] == data[pos + best]) {
+                unsigned len = matchLength(match, data + pos, limit);
+                if (len > best) {
+                    best = len;
+                    distance = dist;
+                    if (len >= NICE_LENGTH || len == limit) break;
+                }
+            }
+            candidate = prev[(candidate - 1) & (WINDOW_SIZE - 1)];
+        }
+        return best >= MIN_MATCH ? best : 0;
+    }
+
+    // Huffman-codes the pending tokens as one segment.
+    void flushSegment(BitWriter& writer) {
+        uint64_t litLenFreq[LITLEN_CODES] = {};
+        uint64_t distFreq[DIST_CODES] = {};
+        for (uint32_t token : tokens) {
+            if (token & MATCH_FLAG) {
+                litLenFreq[257 + bucketOf((token >> 16) & 0x7FFF).code]++;
+                distFreq[bucketOf(token & 0xFFFF).code]++;
+            } else {
+                litLenFreq[token]++;
+            }
+        }
+        litLenFreq[END_OF_SEGMENT]++;
+
+        Huffman::Code litLenCodes[LITLEN_CODES];
+        Huffman::Code distCodes[DIST_CODES];
+        {
+            FC_STAGE(Table);
+            Huffman::buildLengths(litLenFreq, LITLEN_CODES, MAX_CODE_LEN, litLenLengths.data());
+            Huffman::buildLengths(distFreq, DIST_CODES, MAX_CODE_LEN, distLengths.data());
+            Huffman::assignCanonicalCodes(litLenLengths.data(), LITLEN_CODES, litLenCodes);
+            Huffman::assignCanonicalCodes(distLengths.data(), DIST_CODES, distCodes);
+        }
+        writeLengths(writer, litLenLengths.data(), LITLEN_CODES);
+        writeLengths(writer, distLengths.data(), DIST_CODES);
+
+        for (uint32_t token : tokens) {
+            if (!(token & MATCH_FLAG)) {
+                writer.write(litLenCodes[token].bits, litLenCodes[token].len);
+                continue;
+            }
+            Bucket len = bucketOf((token >> 16) & 0x7FFF);
+            const Huffman::Code& lc = litLenCodes[257 + len.code];
+            writer.write((lc.bits << len.extraBits) | len.extra, lc.len + len.extraBits);
+            Bucket dist = bucketOf(token & 0xFFFF);
+            const Huffman::Code& dc = distCodes[dist.code];
+            writer.write((dc.bits << dist.extraBits) | dist.extra, dc.len + dist.extraBits);
+        }
+        writer.write(litLenCodes[END_OF_SEGMENT].bits, litLenCodes[END_OF_SEGMENT].len);
+        tokens.clear();
+    }
+};
+
+LZH::LZH() : work(std::make_unique<Workspace>()) {}
+LZH::~LZH() = default;
+
+uint32_t LZH::encode(const unsigned char* data, size_t size, BitWriter& writer) {
+    FC_STAGE(Encode);
+    Workspace& ws = *work;
+    std::fill(ws.head.begin(), ws.head.end(), 0);
+    ws.tokens.clear();
+    ws.tokens.reserve(SEGMENT_TOKENS);
+
+    Crc32c crc;
+    size_t checked = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        if (pos >= checked) {
+            size_t n = std::min(CHECKSUM_SLICE, size - checked);
+            crc.update(data + checked, n);
+            checked += n;
+        }
+        unsigned len = 0;
+        uint32_t dist = 0;
+        if (size - pos >= MIN_MATCH) {
+            len = ws.findMatch(data, size, pos, dist);
+            ws.insert(data, pos);
+            // Lazy matching: if the next position starts a longer match, emit
+            // this byte as a literal and take that one instead.
+            while (len && len < LAZY_LIMIT && size - pos > MIN_MATCH) {
+                uint32_t nextDist = 0;
+                unsigned next = ws.findMatch(data, size, pos + 1, nextDist);
+                if (next <= len) break;
+                ws.tokens.push_back(data[pos++]);
+                ws.insert(data, pos);
+                len = next;
+                dist = nextDist;
+            }
+        }
+        if (len) {
+            ws.tokens.push_back(MATCH_FLAG | ((len - MIN_MATCH) << 16) | (dist - 1));
+            size_t end = std::min(pos + len, size - MIN_MATCH + 1);
+            for (size_t i = pos + 1; i < end; ++i) ws.insert(data, i);
+            pos += len;
+        } else {
+            ws.tokens.push_back(data[pos++]);
+        }
+        if (ws.tokens.size() >= SEGMENT_TOKENS) ws.flushSegment(writer);
+    }
+    if (!ws.tokens.empty()) ws.flushSegment(writer);
+    crc.update(data + checked, size - checked);
+    return crc.value();
+}
+
+uint32_t LZH::decode(BitReader& reader, unsigned char* out, size_t rawSize) {
+    FC_STAGE(Decode);
+    Workspace& ws = *work;
+    Crc32c crc;
+    size_t pos = 0;
+    while (pos < rawSize) {
+        size_t segmentStart = pos;
+        {
+            FC_STAGE(Table);
+            readLengths(reader, ws.litLenLengths.data(), LITLEN_CODES, MAX_CODE_LEN);
+            readLengths(reader, ws.distLengths.data(), DIST_CODES, MAX_CODE_LEN);
+            buildDecodeTable(ws.litLenLengths.data(), LITLEN_CODES, MAX_CODE_LEN, ws.litLenTable.data());
+            buildDecodeTable(ws.distLengths.data(), DIST_CODES, MAX_CODE_LEN, ws.distTable.data());
+        }
+
+        for (;;) {
+            // The longest token (12 + 13 + 12 + 14 bits) fits in one refill.
+            reader.refill();
+            const DecodeEntry& entry = ws.litLenTable[reader.peek(MAX_CODE_LEN)];
+            if (!entry.len) {
+                throw std::runtime_error("Corrupt LZH stream: invalid code");
+            }
+            reader.consume(entry.len);
+            if (entry.symbol < END_OF_SEGMENT) {
+                if (pos == rawSize) {
+                    throw std::runtime_error("Corrupt LZH stream: too much output");
+                }
+                out[pos++] = static_cast<unsigned char>(entry.symbol);
+                continue;
+            }
+            if (entry.symbol == END_OF_SEGMENT) break;
+
+            size_t len = MIN_MATCH + readBucket(reader, entry.symbol - 257);
+            const DecodeEntry& distEntry = ws.distTable[reader.peek(MAX_CODE_LEN)];
+            if (!distEntry.len) {
+                throw std::runtime_error("Corrupt LZH stream: invalid code");
+            }
+            reader.consume(distEntry.len);
+            size_t dist = 1 + readBucket(reader, distEntry.symbol);
+            if (dist > pos || len > rawSize - pos) {
+                throw std::runtime_error("Corrupt LZH stream: bad match");
+            }
+            unsigned char* dst = out + pos;
+            const unsigned char* src = dst - dist;
+            if (dist >= len) {
+                std::memcpy(dst, src, len);
+            } else {
+                for (size_t i = 0; i < len; ++i) dst[i] = src[i];
+            }
+            pos += len;
+        }
+        if (reader.overrun()) {
+            throw std::runtime_error("Truncated LZH stream");
+        }
+        crc.update(out + segmentStart, pos - segmentStart);
+    }
+    return crc.value();
+}
+
+void LZH::compressBuffer(const unsigned char* data, size_t size, std::string& out) {
+    out.clear();
+    out.append(STREAM_MAGIC, sizeof(STREAM_MAGIC));
+    appendField<uint8_t>(out, STREAM_VERSION);
+    appendField<uint64_t>(out, size);
+    BitWriter writer(out);
+    writer.write(encode(data, size, writer), CHECKSUM_BITS);
+    writer.flush();
+}
+
+void LZH::decompressBuffer(const unsigned char* data, size_t size, std::string& out) {
+    if (size < STREAM_HEADER_SIZE || std::memcmp(data, STREAM_MAGIC, sizeof(STREAM_MAGIC)) != 0) {
+        throw std::runtime_error("Not an LZH compressed buffer");
+    }
+    if (data[sizeof(STREAM_MAGIC)] != STREAM_VERSION) {
+        throw std::runtime_error("Unsupported LZH stream version");
+    }
+    uint64_t rawSize = readField<uint64_t>(data + sizeof(STREAM_MAGIC) + 1);
+    size_t payloadSize = size - STREAM_HEADER_SIZE;
+    // Every token takes at least one bit, so a bogus size fails before allocating.
+    if (rawSize / MAX_MATCH > payloadSize * 8) {
+        throw std::runtime_error("Truncated LZH stream");
+    }
+
+    out.resize(static_cast<size_t>(rawSize));
+    BitReader reader(data + STREAM_HEADER_SIZE, payloadSize);
+    uint32_t crc = decode(reader, reinterpret_cast<unsigned char*>(&out[0]), out.size());
+    reader.refill();
+    uint32_t stored = static_cast<uint32_t>(reader.peek(CHECKSUM_BITS));
+    reader.consume(CHECKSUM_BITS);
+    if (reader.overrun()) {
+        throw std::runtime_error("Truncated LZH stream");
+    }
+    if (stored != crc) {
+        throw std::runtime_error("LZH checksum mismatch");
+    }
+}
+
+namespace {
+    LZH& threadCoder() {
+        thread_local LZH coder;
+        return coder;
+    }
+}
+
+void LZH::encodeBlock(const std::string& block, std::string& frame) {
+    frame.clear();
+    appendField<uint32_t>(frame, static_cast<uint32_t>(block.size()));
+    appendField<uint32_t>(frame, 0);    // payload size and checksum, filled in once coded
+    appendField<uint32_t>(frame, 0);
+    uint32_t crc;
+    {
+        BitWriter writer(frame);
+        crc = threadCoder().encode(reinterpret_cast<const unsigned char*>(block.data()), block.size(), writer);
+        writer.flush();
+    }
+    uint32_t payloadSize = static_cast<uint32_t>(frame.size() - FRAME_HEADER_SIZE);
+    std::memcpy(&frame[sizeof(uint32_t)], &payloadSize, sizeof(payloadSize));
+    std::memcpy(&frame[2 * sizeof(uint32_t)], &crc, sizeof(crc));
+    FC_COUNT(BytesIn, block.size());
+    FC_COUNT(BytesOut, frame.size());
+    FC_COUNT(Blocks, 1);
+}
+
+void LZH::decodeBlock(const std::string& frame, std::string& block) {
+    if (frame.size() < FRAME_HEADER_SIZE) {
+        throw std::runtime_error("Corrupt LZH block: truncated frame");
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(frame.data());
+    uint32_t rawSize = readField<uint32_t>(p);
+    uint32_t payloadSize = readField<uint32_t>(p + sizeof(uint32_t));
+    uint32_t crc = readField<uint32_t>(p + 2 * sizeof(uint32_t));
+    if (frame.size() - FRAME_HEADER_SIZE != payloadSize || rawSize / MAX_MATCH > uint64_t(payloadSize) * 8) {
+        throw std::runtime_error("Corrupt LZH block: bad frame header");
+    }
+    block.resize(rawSize);
+    BitReader reader(p + FRAME_HEADER_SIZE, payloadSize);
+    if (threadCoder().decode(reader, reinterpret_cast<unsigned char*>(&block[0]), rawSize) != crc) {
+        throw std::runtime_error("LZH block checksum mismatch");
+    }
+    FC_COUNT(BytesIn, frame.size());
+    FC_COUNT(BytesOut, rawSize);
+    FC_COUNT(Blocks, 1);
+}
+
+// A literal costs at most MAX_CODE_LEN bits and a match of MIN_MATCH or more
+// bytes at most two codes plus 27 extra bits, so no byte needs more than 16
+// bits. Each segment adds its two code tables and the end-of-segment code.
+uint64_t LZH::maxPayloadSize(uint32_t rawSize) {
+    uint64_t segments = rawSize / SEGMENT_TOKENS + 1;
+    uint64_t bits = uint64_t(rawSize) * 16 + segments * ((LITLEN_CODES + DIST_CODES) * 4 + MAX_CODE_LEN);
+    return (bits + 7) / 8;
+}
+
+bool LZH::readFrame(std::istream& in, uint32_t blockSize, std::string& frame) {
+    frame.resize(FRAME_HEADER_SIZE);
+    in.read(&frame[0], sizeof(uint32_t));
+    if (!in) {
+        throw std::runtime_error("Truncated LZH block container");
+    }
+    uint32_t rawSize;
+    std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+    if (rawSize == 0) return false;
+    if (rawSize > blockSize) {
+        throw std::runtime_error("Corrupt LZH block: larger than the container's block size");
+    }
+
+    in.read(&frame[sizeof(uint32_t)], FRAME_HEADER_SIZE - sizeof(uint32_t));
+    uint32_t payloadSize;
+    std::memcpy(&payloadSize, frame.data() + sizeof(uint32_t), sizeof(payloadSize));
+    if (!in) {
+        throw std::runtime_error("Truncated LZH block container");
+    }
+    if (payloadSize > maxPayloadSize(rawSize)) {
+        throw std::runtime_error("Corrupt LZH block: payload larger than its data can code to");
+    }
+    frame.resize(FRAME_HEADER_SIZE + payloadSize);
+    in.read(&frame[FRAME_HEADER_SIZE], payloadSize);
+    if (!in) {
+        throw std::runtime_error("Truncated LZH block container");
+    }
+    return true;
+}
+
+void LZH::compress(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    using namespace std::chrono;
+    auto start = high_resolution_clock::now();
+
+    InputFile input(inputFile, InputFile::Access::Streamed);
+    OutputFile output(outputFile);
+    std::istream& in = input.stream();
+    std::ostream& out = output.stream();
+
+    out.write(BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    out.write(reinterpret_cast<const char*>(&BLOCK_VERSION), sizeof(BLOCK_VERSION));
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    out.write(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
+
+    std::vector<std::pair<uint64_t, uint64_t>> index;   // (rawOffset, frameOffset)
+    uint64_t frameOffset = sizeof(BLOCK_MAGIC) + sizeof(BLOCK_VERSION) + sizeof(blockSize);
+    uint64_t rawOffset = 0;
+    uint32_t streamCrc = Crc32c().value();
+
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& block) {
+            FC_STAGE(Read);
+            block.resize(blockSize);
+            in.read(&block[0], blockSize);
+            block.resize(static_cast<size_t>(in.gcount()));
+            if (in.bad()) {
+                throw std::runtime_error("Could not read input");
+            }
+            return !block.empty();
+        },
+        encodeBlock,
+        [&](const std::string& frame) {
+            FC_STAGE(Write);
+            uint32_t rawSize, crc;
+            std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+            std::memcpy(&crc, frame.data() + 2 * sizeof(uint32_t), sizeof(crc));
+            streamCrc = Crc32c::combine(streamCrc, crc, rawSize);
+            index.emplace_back(rawOffset, frameOffset);
+            out.write(frame.data(), frame.size());
+            frameOffset += frame.size();
+            rawOffset += rawSize;
+        });
+
+    uint32_t terminator = 0;
+    out.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator));
+    out.write(reinterpret_cast<const char*>(&streamCrc), sizeof(streamCrc));
+
+    uint64_t indexOffset = frameOffset + sizeof(terminator) + sizeof(streamCrc);
+    uint32_t indexCount = static_cast<uint32_t>(index.size());
+    out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+    for (auto& entry : index) {
+        out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+        out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+    }
+    out.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    out.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    output.close();
+
+    double timeTaken = duration<double>(high_resolution_clock::now() - start).count();
+    uint64_t outSize = indexOffset + sizeof(indexCount) + index.size() * 2 * sizeof(uint64_t)
+                       + sizeof(indexOffset) + sizeof(INDEX_MAGIC);
+    double ratio = rawOffset ? (1.0 - (double)outSize / rawOffset) * 100.0 : 0.0;
+    double throughput = timeTaken > 0 ? (rawOffset / (1024.0 * 1024.0)) / timeTaken : 0.0;
+
+    Utils::log() << "✅ [LZH] Compression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << index.size() << " | Input: " << rawOffset
+                 << " bytes | Output: " << outSize << " bytes | Ratio: " << ratio << "% | Time: " << timeTaken
+                 << "s | Throughput: " << throughput << " MB/s\n";
+}
+
+void LZH::decompress(const std::string& inputFile, const std::string& outputFile, int numThreads) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    InputFile input(inputFile, InputFile::Access::Streamed);
+    std::istream& in = input.stream();
+
+    char magic[4] = {};
+    uint8_t version = 0;
+    uint32_t blockSize = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+    if (!in || std::memcmp(magic, BLOCK_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an LZH compressed file: " + inputFile);
+    }
+    if (version != BLOCK_VERSION) {
+        throw std::runtime_error("Unsupported LZH container version: " + inputFile);
+    }
+
+    OutputFile output(outputFile);
+    std::ostream& out = output.stream();
+    uint64_t outSize = 0;
+    uint64_t blockCount = 0;
+    uint32_t streamCrc = Crc32c().value();
+    BlockPipeline::BlockIndex index;
+    uint64_t rawOffset = 0;
+    uint64_t frameOffset = sizeof(BLOCK_MAGIC) + sizeof(version) + sizeof(blockSize);
+    size_t window = BlockPipeline::windowForMemory(memoryLimit, 2 * static_cast<size_t>(blockSize), numThreads);
+    BlockPipeline pipeline(numThreads, window);
+    pipeline.run(
+        [&](std::string& frame) {
+            FC_STAGE(Read);
+            if (!readFrame(in, blockSize, frame)) return false;
+            // Block checksums are verified by decodeBlock; chaining them
+            // also catches missing or reordered blocks.
+            uint32_t rawSize, crc;
+            std::memcpy(&rawSize, frame.data(), sizeof(rawSize));
+            std::memcpy(&crc, frame.data() + 2 * sizeof(uint32_t), sizeof(crc));
+            streamCrc = Crc32c::combine(streamCrc, crc, rawSize);
+            index.emplace_back(rawOffset, frameOffset);
+            rawOffset += rawSize;
+            frameOffset += frame.size();
+            return true;
+        },
+        decodeBlock,
+        [&](const std::string& block) {
+            FC_STAGE(Write);
+            out.write(block.data(), block.size());
+            outSize += block.size();
+            blockCount++;
+        });
+
+    uint32_t storedCrc = 0;
+    in.read(reinterpret_cast<char*>(&storedCrc), sizeof(storedCrc));
+    if (!in || storedCrc != streamCrc) {
+        throw std::runtime_error("LZH stream checksum mismatch: " + inputFile);
+    }
+    BlockPipeline::checkIndex(in, index, frameOffset + 2 * sizeof(uint32_t), INDEX_MAGIC);
+    output.close();
+
+    double timeTaken = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    double throughput = timeTaken > 0 ? (outSize / (1024.0 * 1024.0)) / timeTaken : 0.0;
+    Utils::log() << "✅ [LZH] Decompression complete.\n";
+    Utils::log() << "Threads: " << numThreads << " | Blocks: " << blockCount << " | Output: " << outSize
+                 << " bytes | Time: " << timeTaken << "s | Throughput: " << throughput << " MB/s\n";
+}
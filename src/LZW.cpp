@@ -1,105 +1,687 @@
 #include <LZW.hpp>
-#include <fstream>
+#include "BitIO.hpp"
+#include "Checksum.hpp"
+#include "FileIO.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
-#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
-void LZW::compress(const std::string& inputFile, const std::string& outputFile){
-    auto start = std::chrono::high_resolution_clock::now();
+namespace {
+    constexpr size_t IO_BUFFER_SIZE = 1 << 16;
+    constexpr size_t DECODE_BUFFER_SIZE = 1 << 20;
+    // Once the dictionary is full, the compression ratio is re-checked after
+    // this many input bytes; a drop triggers a CLEAR.
+    constexpr uint64_t RATIO_CHECK_INTERVAL = 1 << 16;
+}
 
-    std::ifstream in(inputFile, std::ios::binary);
-    std::ofstream out(outputFile, std::ios::binary);
-    if(!in.is_open() || !out.is_open()){
-        std::cerr<<"Error opening files.\n";
-        return;
+// Open-addressing map from (prefix code, next byte) to the code of the
+// extended phrase. A lookup hashes one 64-bit key instead of the whole
+// phrase, and the table is preallocated at twice the largest dictionary,
+// so a compression step costs O(1) and never allocates.
+class LZW::PhraseTable {
+public:
+    explicit PhraseTable(size_t maxEntries) : maxEntries(maxEntries) {
+        size_t capacity = 1;
+        while (capacity < 2 * maxEntries) capacity <<= 1;
+        keys.assign(capacity, 0);
+        values.assign(capacity, 0);
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) shift--;
+        used.reserve(maxEntries);
     }
 
-    // Initialize dictionary with all single character
-    std::unordered_map<std::string, int> dict;
-    for(int i = 0; i < 256; i++){
-        dict[std::string(1, char(i))] = i;
+    size_t maxEntryCount() const { return maxEntries; }
+
+    // Returns the code for (prefix, byte), or -1 if the phrase is unknown.
+    // A nonzero MaxBits promises a table of 2^MaxBits entries, which makes
+    // the slot mask and hash shift compile-time constants.
+    template <unsigned MaxBits = 0>
+    inline int find(int prefix, unsigned char byte) const {
+        uint64_t key = makeKey(prefix, byte);
+        for (size_t slot = hash<MaxBits>(key); keys[slot] != 0; slot = (slot + 1) & slotMask<MaxBits>()) {
+            if (keys[slot] == key) return values[slot];
+        }
+        return -1;
     }
 
-    std::string w;
-    char c;
-    int code = 256;
-    while(in.get(c)){
-        std::string wc = w + c;
-        if(dict.find(wc) != dict.end()){
-            w = wc;
-        } else {
-            out.write(reinterpret_cast<const char*>(&dict[w]), sizeof(int));
-            dict[wc] = code++;
-            w = std::string(1, c);
+    // Like find(), but inserts `newCode` for an unknown phrase.
+    template <unsigned MaxBits = 0>
+    inline int findOrInsert(int prefix, unsigned char byte, int newCode) {
+        uint64_t key = makeKey(prefix, byte);
+        size_t slot = hash<MaxBits>(key);
+        while (keys[slot] != 0) {
+            if (keys[slot] == key) return values[slot];
+            slot = (slot + 1) & slotMask<MaxBits>();
         }
+        keys[slot] = key;
+        values[slot] = newCode;
+        used.push_back(static_cast<uint32_t>(slot));
+        return -1;
+    }
+
+    // Only the occupied slots are reset, so clearing after a short input
+    // costs as little as filling it did. Entries added before keepAsBase()
+    // (a primed dictionary) survive clear(): they were inserted first, so
+    // their probe sequences never run through the slots being emptied.
+    void clear() {
+        for (size_t i = baseCount; i < used.size(); ++i) keys[used[i]] = 0;
+        used.resize(baseCount);
+    }
+    void keepAsBase() { baseCount = used.size(); }
+    void reset() {
+        baseCount = 0;
+        clear();
     }
 
-    if(!w.empty()){
-        out.write(reinterpret_cast<const char*>(&dict[w]), sizeof(int));
+private:
+    static inline uint64_t makeKey(int prefix, unsigned char byte) {
+        return ((static_cast<uint64_t>(prefix) << 8) | byte) + 1;
     }
 
-    in.close();
-    out.close();
+    // The capacity is the power of two at or above twice the entry count:
+    // 2^(MaxBits + 1) slots for a full-width table.
+    template <unsigned MaxBits>
+    inline size_t slotMask() const {
+        return MaxBits ? (size_t(2) << MaxBits) - 1 : mask;
+    }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    double timeTaken = std::chrono::duration<double>(end - start).count();
+    template <unsigned MaxBits>
+    inline size_t hash(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (MaxBits ? 63 - MaxBits : shift));
+    }
+
+    size_t maxEntries;
+    std::vector<uint64_t> keys;   // (prefix << 8 | byte) + 1, 0 = empty
+    std::vector<int> values;
+    std::vector<uint32_t> used;   // occupied slots, for clear()
+    size_t baseCount = 0;
+    size_t mask = 0;
+    unsigned shift = 64;
+};
+
+LZW::LZW() = default;
+LZW::~LZW() = default;
 
-    auto inSize = std::filesystem::file_size(inputFile);
-    auto outSize = std::filesystem::file_size(outputFile);
-    double ratio = (1.0 - (double)outSize / inSize) * 100.0;
+void LZW::setMaxCodeBits(unsigned bits) {
+    if (bits < MIN_CODE_BITS || bits > MAX_CODE_BITS) {
+        throw std::runtime_error("LZW code width must be between 9 and 24 bits");
+    }
+    maxCodeBits = bits;
+}
 
-    std::cout << "✅ [LZW] Compression complete.\n";
-    std::cout << "Input: " << inSize << " bytes | Output: " << outSize << " bytes | ";
-    std::cout << "Ratio: " << ratio << "% | Time: " << timeTaken << "s\n";
+unsigned LZW::codeWidth(int nextCode) {
+    unsigned width = MIN_CODE_BITS;
+    while ((1 << width) < nextCode) width++;
+    return width;
 }
 
-void LZW::decompress(const std::string& inputFile, const std::string& outputFile){
-    auto start = std::chrono::high_resolution_clock::now();
+void LZW::setDictionary(std::shared_ptr<const Dictionary> dict) {
+    if (dict) checkDictionary(*dict);
+    dictionary = std::move(dict);
+}
+
+void LZW::checkDictionary(const Dictionary& dict) {
+    unsigned bits = dict.lzwCodeBits();
+    if (bits < MIN_CODE_BITS || bits > MAX_CODE_BITS
+        || dict.lzwPhrases().size() > ((size_t(1) << bits) - FIRST_CODE) / 2) {
+        throw std::runtime_error("Corrupt dictionary: bad LZW phrases");
+    }
+    uint32_t code = FIRST_CODE;
+    for (const Dictionary::Phrase& phrase : dict.lzwPhrases()) {
+        if (phrase.prefix >= 256 && (phrase.prefix < FIRST_CODE || phrase.prefix >= code)) {
+            throw std::runtime_error("Corrupt dictionary: bad LZW phrases");
+        }
+        code++;
+    }
+}
+
+std::vector<Dictionary::Phrase> LZW::trainPhrases(const std::vector<std::string>& samples, unsigned bits) {
+    if (bits < MIN_CODE_BITS || bits > MAX_CODE_BITS) {
+        throw std::runtime_error("LZW code width must be between 9 and 24 bits");
+    }
+    const size_t maxCode = size_t(1) << bits;
 
-    std::ifstream in(inputFile, std::ios::binary);
-    std::ofstream out(outputFile, std::ios::binary);
-    if(!in.is_open() || !out.is_open()){
-        std::cerr<<"Error opening files.\n";
-        return;
+    // Grow a dictionary over the corpus as the encoder would, each sample
+    // parsed on its own, until every code is taken.
+    PhraseTable table(maxCode);
+    std::vector<Dictionary::Phrase> grown;
+    for (const std::string& sample : samples) {
+        int w = -1;
+        for (unsigned char c : sample) {
+            if (w < 0) {
+                w = c;
+                continue;
+            }
+            int next = FIRST_CODE + grown.size() < maxCode
+                ? table.findOrInsert(w, c, static_cast<int>(FIRST_CODE + grown.size()))
+                : table.find(w, c);
+            if (next >= 0) {
+                w = next;
+                continue;
+            }
+            if (FIRST_CODE + grown.size() < maxCode) {
+                grown.push_back({static_cast<uint32_t>(w), c});
+            }
+            w = c;
+        }
     }
 
-    //Initialize reverse dictionary
-    std::vector<std::string> dict(4096);
-    for(int i = 0; i<256; i++){
-        dict[i] = std::string(1, char(i));
+    // Count how often a greedy parse with the finished dictionary walks
+    // through each phrase. A phrase is walked through whenever one of its
+    // extensions is, so no phrase counts more than its prefix.
+    std::vector<uint64_t> hits(grown.size(), 0);
+    for (const std::string& sample : samples) {
+        int w = -1;
+        for (unsigned char c : sample) {
+            int next = w < 0 ? -1 : table.find(w, c);
+            if (next >= 0) hits[next - FIRST_CODE]++;
+            w = next >= 0 ? next : c;
+        }
     }
 
-    int prevCode, currCode;
-    in.read(reinterpret_cast<char*>(&prevCode), sizeof(int));
-    std::string s = dict[prevCode];
-    out << s;
+    // Keep the most used phrases that recur at all. Ties go to the lower
+    // code, so every kept phrase's prefix is kept as well.
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < grown.size(); ++i) {
+        if (hits[i] >= 2) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return hits[a] > hits[b]; });
+    order.resize(std::min(order.size(), (maxCode - FIRST_CODE) / 2));
+    std::sort(order.begin(), order.end());
 
-    int code = 256;
-    while(in.read(reinterpret_cast<char*>(&currCode), sizeof(int))){
-        std::string entry;
-        if(currCode < code){
-            entry = dict[currCode];
-        } else if(currCode == code){
-            entry = dict[prevCode] + s[0];
-        } else {
+    std::vector<uint32_t> renumbered(grown.size(), 0);
+    std::vector<Dictionary::Phrase> kept;
+    kept.reserve(order.size());
+    for (uint32_t i : order) {
+        Dictionary::Phrase phrase = grown[i];
+        if (phrase.prefix >= FIRST_CODE) phrase.prefix = renumbered[phrase.prefix - FIRST_CODE];
+        renumbered[i] = static_cast<uint32_t>(FIRST_CODE + kept.size());
+        kept.push_back(phrase);
+    }
+    return kept;
+}
+
+std::string LZW::encodeHeader() const {
+    std::string header(dictionary ? DICT_MAGIC : MAGIC, sizeof(MAGIC));
+    header.push_back(static_cast<char>(VERSION));
+    header.push_back(static_cast<char>(dictionary ? dictionary->lzwCodeBits() : maxCodeBits));
+    if (dictionary) {
+        uint32_t id = dictionary->id();
+        header.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    }
+    return header;
+}
+
+bool LZW::isDictionaryStream(const char* header) {
+    return std::memcmp(header, DICT_MAGIC, sizeof(DICT_MAGIC)) == 0;
+}
+
+const Dictionary& LZW::dictionaryFor(const char* idBytes, unsigned bits) {
+    uint32_t id;
+    std::memcpy(&id, idBytes, sizeof(id));
+    const Dictionary* dict = dictionary.get();
+    if (!dict || dict->id() != id) {
+        std::shared_ptr<const Dictionary> previous = loadedDictionary;
+        loadedDictionary = Dictionary::resolve(loadedDictionary, dictionaryDir, id);
+        if (loadedDictionary != previous) checkDictionary(*loadedDictionary);
+        dict = loadedDictionary.get();
+    }
+    if (dict->lzwCodeBits() != bits) {
+        throw std::runtime_error("LZW stream does not match its dictionary");
+    }
+    return *dict;
+}
+
+unsigned LZW::parseHeader(const char* header) {
+    if(std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 && !isDictionaryStream(header)){
+        throw std::runtime_error("Not an LZW stream (or a pre-versioned raw-int file)");
+    }
+    int version = static_cast<unsigned char>(header[sizeof(MAGIC)]);
+    int bits = static_cast<unsigned char>(header[sizeof(MAGIC) + 1]);
+    if(version != VERSION || bits < static_cast<int>(MIN_CODE_BITS) || bits > static_cast<int>(MAX_CODE_BITS)){
+        throw std::runtime_error("Unsupported LZW stream version or code width");
+    }
+    return static_cast<unsigned>(bits);
+}
+
+template <typename NextChunk>
+LZW::EncodeStats LZW::encode(NextChunk nextChunk, BitWriter& writer){
+    // Codes 0-255 are the single bytes and need no table entries; every
+    // longer phrase is stored as (code of its prefix, last byte).
+    const Dictionary* shared = dictionary.get();
+    const unsigned bits = shared ? shared->lzwCodeBits() : maxCodeBits;
+    const int maxCode = 1 << bits;
+    if(!phrases || phrases->maxEntryCount() != static_cast<size_t>(maxCode)){
+        phrases = std::make_unique<PhraseTable>(maxCode);
+        encodePrimed = false;
+    }
+    // Priming happens once per dictionary; after that a payload only pays
+    // for clearing the phrases it added itself.
+    if(shared ? !encodePrimed || encodePrimedId != shared->id() : encodePrimed){
+        phrases->reset();
+        encodePrimed = false;
+        if(shared){
+            int c = FIRST_CODE;
+            for(const Dictionary::Phrase& phrase : shared->lzwPhrases()){
+                phrases->findOrInsert(static_cast<int>(phrase.prefix), phrase.byte, c++);
+            }
+            phrases->keepAsBase();
+            encodePrimed = true;
+            encodePrimedId = shared->id();
+        }
+    } else {
+        phrases->clear();
+    }
+    const int base = FIRST_CODE + (shared ? static_cast<int>(shared->lzwPhrases().size()) : 0);
+
+    switch(bits){
+        case 12: return encodeWith<12>(nextChunk, writer, bits, base);
+        case 16: return encodeWith<16>(nextChunk, writer, bits, base);
+        default: return encodeWith<0>(nextChunk, writer, bits, base);
+    }
+}
+
+template <unsigned MaxBits, typename NextChunk>
+LZW::EncodeStats LZW::encodeWith(NextChunk& nextChunk, BitWriter& writer, unsigned bits, int base){
+    const int maxCode = 1 << (MaxBits ? MaxBits : bits);
+    PhraseTable& dict = *phrases;
+
+    FC_STAGE(Encode);
+    EncodeStats stats;
+    int w = -1;     // code of the current phrase, -1 before the first byte
+    int code = base;
+    unsigned width = codeWidth(base);
+
+    // Ratio bookkeeping since the last CLEAR (input bytes per output bit).
+    uint64_t inSinceReset = 0;
+    uint64_t bitsSinceReset = 0;
+    uint64_t nextCheck = 0;
+    double bestRatio = 0.0;
+
+    auto emit = [&](int c) {
+        writer.write(static_cast<uint64_t>(c), width);
+        bitsSinceReset += width;
+    };
+
+    Crc32c crc;
+    const unsigned char* chunk = nullptr;
+    while(size_t n = nextChunk(chunk)){
+        stats.inSize += n;
+        crc.update(chunk, n);
+        for(size_t i = 0; i < n; ++i){
+            unsigned char c = chunk[i];
+            inSinceReset++;
+            if(w < 0){
+                w = c;
+                continue;
+            }
+            if(code < maxCode){
+                int next = dict.template findOrInsert<MaxBits>(w, c, code);
+                if(next >= 0){
+                    w = next;
+                    continue;
+                }
+                emit(w);
+                w = c;
+                if(++code > (1 << width)) width++;
+                if(code == maxCode){
+                    // Dictionary just filled: start watching the ratio.
+                    bestRatio = static_cast<double>(inSinceReset) / bitsSinceReset;
+                    nextCheck = inSinceReset + RATIO_CHECK_INTERVAL;
+                }
+                continue;
+            }
+
+            // Full dictionary: keep using it until the ratio starts to drop.
+            int next = dict.template find<MaxBits>(w, c);
+            if(next >= 0){
+                w = next;
+                continue;
+            }
+            emit(w);
+            w = c;
+            if(inSinceReset >= nextCheck){
+                nextCheck = inSinceReset + RATIO_CHECK_INTERVAL;
+                double ratio = static_cast<double>(inSinceReset) / bitsSinceReset;
+                if(ratio > bestRatio){
+                    bestRatio = ratio;
+                } else {
+                    emit(CLEAR_CODE);
+                    stats.outBits += bitsSinceReset;
+                    stats.peakCodes = std::max<uint64_t>(stats.peakCodes, code);
+                    dict.clear();
+                    code = base;
+                    width = codeWidth(base);
+                    inSinceReset = 1;   // `c` already belongs to the new phrase
+                    bitsSinceReset = 0;
+                    stats.resets++;
+                }
+            }
+        }
+    }
+
+    if(w >= 0){
+        emit(w);
+        // The decoder sizes each code as if an entry followed every code but
+        // the first, so account for one before sizing END.
+        if(code < maxCode && ++code > (1 << width)) width++;
+    }
+    emit(END_CODE);
+    writer.write(crc.value(), CHECKSUM_BITS);
+    writer.flush();
+    stats.outBits += bitsSinceReset + CHECKSUM_BITS;
+    stats.peakCodes = std::max<uint64_t>(stats.peakCodes, code);
+    FC_COUNT(LzwResets, stats.resets);
+    FC_PEAK(LzwPeakCodes, stats.peakCodes);
+    FC_PEAK(LzwCodeCapacity, maxCode);
+    return stats;
+}
+
+void LZW::prepareDecodeTables(int maxCode){
+    // Entries 0-255 never change, so they are set up once per allocation;
+    // later codes are always written before they are read.
+    if(prefix.size() >= static_cast<size_t>(maxCode)) return;
+    decodePrimed = false;
+    prefix.resize(maxCode);
+    length.resize(maxCode);
+    lastByte.resize(maxCode);
+    firstByte.resize(maxCode);
+    for(int i = 0; i < 256; i++){
+        length[i] = 1;
+        lastByte[i] = firstByte[i] = static_cast<unsigned char>(i);
+    }
+}
+
+void LZW::primeDecodeTables(const Dictionary& dict){
+    if(decodePrimed && decodePrimedId == dict.id()) return;
+    uint32_t code = FIRST_CODE;
+    for(const Dictionary::Phrase& phrase : dict.lzwPhrases()){
+        prefix[code] = phrase.prefix;
+        lastByte[code] = phrase.byte;
+        firstByte[code] = firstByte[phrase.prefix];
+        length[code] = length[phrase.prefix] + 1;
+        code++;
+    }
+    decodePrimed = true;
+    decodePrimedId = dict.id();
+}
+
+template <typename MakeRoom>
+uint64_t LZW::decode(BitReader& reader, unsigned bits, const Dictionary* dict, std::string& buffer, size_t& outPos,
+                     MakeRoom makeRoom){
+    // CLEAR and END take slots 256/257; a dictionary's phrases follow.
+    prepareDecodeTables(1 << bits);
+    int base = FIRST_CODE;
+    if(dict){
+        primeDecodeTables(*dict);
+        base += static_cast<int>(dict->lzwPhrases().size());
+    } else {
+        decodePrimed = false;
+    }
+
+    switch(bits){
+        case 12: return decodeWith<12>(reader, bits, base, buffer, outPos, makeRoom);
+        case 16: return decodeWith<16>(reader, bits, base, buffer, outPos, makeRoom);
+        default: return decodeWith<0>(reader, bits, base, buffer, outPos, makeRoom);
+    }
+}
+
+template <unsigned MaxBits, typename MakeRoom>
+uint64_t LZW::decodeWith(BitReader& reader, unsigned bits, int base, std::string& buffer, size_t& outPos,
+                         MakeRoom& makeRoom){
+    const int maxCode = 1 << (MaxBits ? MaxBits : bits);
+    // Plain pointers: stores into the output would otherwise force the
+    // vectors' data pointers to be reloaded for every byte.
+    uint32_t* const prefixOf = prefix.data();
+    uint32_t* const lengthOf = length.data();
+    unsigned char* const lastByteOf = lastByte.data();
+    unsigned char* const firstByteOf = firstByte.data();
+    char* out = &buffer[0];
+
+    FC_STAGE(Decode);
+    uint64_t codesRead = 0;
+    uint64_t resets = 0;
+    int peakCodes = base;
+    int prevCode = -1;
+    int next = base;
+    unsigned width = codeWidth(base);
+    // Output before `checked` has been added to the CRC.
+    Crc32c crc;
+    size_t checked = outPos;
+
+    // Expands `code` backwards into out[at, at + length).
+    auto expand = [&](uint32_t code, size_t at) {
+        char* p = out + at + lengthOf[code];
+        while(code >= 256){
+            *--p = static_cast<char>(lastByteOf[code]);
+            code = prefixOf[code];
+        }
+        *--p = static_cast<char>(code);
+    };
+
+    for(;;){
+        // Mirror the encoder, whose dictionary runs one entry ahead of ours.
+        // The bound only grows until the next CLEAR, so the width is bumped
+        // rather than recomputed.
+        int bound = prevCode < 0 ? base : std::min(next + 1, maxCode);
+        while((1 << width) < bound) width++;
+        reader.refill();
+        int currCode = static_cast<int>(reader.peek(width));
+        reader.consume(width);
+        codesRead++;
+        if(reader.overrun()){
+            throw std::runtime_error("Truncated LZW stream");
+        }
+        if(currCode == END_CODE){
+            crc.update(out + checked, outPos - checked);
+            reader.refill();
+            uint32_t stored = static_cast<uint32_t>(reader.peek(CHECKSUM_BITS));
+            reader.consume(CHECKSUM_BITS);
+            if(reader.overrun()){
+                throw std::runtime_error("Truncated LZW stream");
+            }
+            if(stored != crc.value()){
+                throw std::runtime_error("LZW checksum mismatch");
+            }
             break;
         }
-        out << entry;
-        dict[code++] = dict[prevCode] + entry[0];
+        if(currCode == CLEAR_CODE){
+            peakCodes = std::max(peakCodes, next);
+            resets++;
+            next = base;
+            prevCode = -1;
+            width = codeWidth(base);
+            continue;
+        }
+
+        bool known = currCode < next && (currCode < 256 || currCode >= FIRST_CODE);
+        bool repeat = currCode == next && prevCode >= 0 && next < maxCode;
+        if(!known && !repeat){
+            throw std::runtime_error("Corrupt LZW stream");
+        }
+
+        // KwKwK case: the phrase is the previous one plus its own first byte.
+        size_t entryLen = repeat ? lengthOf[prevCode] + 1 : lengthOf[currCode];
+        unsigned char entryFirst = repeat ? firstByteOf[prevCode] : firstByteOf[currCode];
+        if(outPos + entryLen > buffer.size()){
+            crc.update(out + checked, outPos - checked);
+            makeRoom(outPos, entryLen);
+            out = &buffer[0];
+            checked = outPos;
+        }
+        if(repeat){
+            expand(prevCode, outPos);
+            out[outPos + entryLen - 1] = static_cast<char>(entryFirst);
+        } else {
+            expand(currCode, outPos);
+        }
+        outPos += entryLen;
+
+        if(prevCode >= 0 && next < maxCode){
+            prefixOf[next] = prevCode;
+            lastByteOf[next] = entryFirst;
+            firstByteOf[next] = firstByteOf[prevCode];
+            lengthOf[next] = lengthOf[prevCode] + 1;
+            next++;
+        }
         prevCode = currCode;
-        s = entry;
+    }
+    FC_COUNT(LzwResets, resets);
+    FC_PEAK(LzwPeakCodes, std::max(peakCodes, next));
+    FC_PEAK(LzwCodeCapacity, maxCode);
+    return codesRead;
+}
+
+void LZW::compress(const std::string& inputFile, const std::string& outputFile){
+    auto start = std::chrono::high_resolution_clock::now();
+
+    InputFile input(inputFile);
+    OutputFile output(outputFile);
+    std::istream& in = input.stream();
+    std::ostream& out = output.stream();
+
+    // --- HEADER ---
+    std::string header = encodeHeader();
+    out.write(header.data(), header.size());
+
+    // Mapped input is consumed in place, a slice at a time so the checksum
+    // reads it while it is still in cache; pipes are read through a fixed
+    // buffer.
+    std::vector<char> buffer;
+    size_t mappedPos = 0;
+    auto nextChunk = [&](const unsigned char*& chunk) -> size_t {
+        if(input.isMapped()){
+            size_t n = std::min(IO_BUFFER_SIZE, input.size() - mappedPos);
+            chunk = input.data() + mappedPos;
+            mappedPos += n;
+            return n;
+        }
+        if(buffer.empty()) buffer.resize(IO_BUFFER_SIZE);
+        FC_STAGE(Read);
+        in.read(buffer.data(), buffer.size());
+        chunk = reinterpret_cast<const unsigned char*>(buffer.data());
+        return static_cast<size_t>(in.gcount());
+    };
+
+    BitWriter writer(out);
+    EncodeStats stats = encode(nextChunk, writer);
+    {
+        FC_STAGE(Write);
+        output.close();
     }
 
-    in.close();
-    out.close();
+    auto end = std::chrono::high_resolution_clock::now();
+    double timeTaken = std::chrono::duration<double>(end - start).count();
+
+    uint64_t outSize = header.size() + (stats.outBits + 7) / 8;
+    FC_COUNT(BytesIn, stats.inSize);
+    FC_COUNT(BytesOut, outSize);
+    double ratio = (1.0 - (double)outSize / stats.inSize) * 100.0;
+
+    Utils::log() << "✅ [LZW] Compression complete.\n";
+    Utils::log() << "Input: " << stats.inSize << " bytes | Output: " << outSize << " bytes | ";
+    Utils::log() << "Ratio: " << ratio << "% | Max bits: " << static_cast<int>(header[sizeof(MAGIC) + 1])
+                 << " | Resets: " << stats.resets
+                 << " | Time: " << timeTaken << "s\n";
+}
+
+void LZW::decompress(const std::string& inputFile, const std::string& outputFile){
+    auto start = std::chrono::high_resolution_clock::now();
+
+    InputFile input(inputFile);
+    OutputFile output(outputFile);
+    std::istream& in = input.stream();
+    std::ostream& out = output.stream();
+
+    // --- HEADER ---
+    char header[HEADER_SIZE] = {};
+    in.read(header, HEADER_SIZE);
+    if(!in){
+        throw std::runtime_error("Not an LZW stream (or a pre-versioned raw-int file): " + inputFile);
+    }
+    unsigned bits = parseHeader(header);
+    size_t headerSize = HEADER_SIZE;
+    const Dictionary* dict = nullptr;
+    if(isDictionaryStream(header)){
+        char id[DICT_ID_SIZE];
+        in.read(id, DICT_ID_SIZE);
+        if(!in){
+            throw std::runtime_error("Truncated LZW header: " + inputFile);
+        }
+        dict = &dictionaryFor(id, bits);
+        headerSize += DICT_ID_SIZE;
+    }
+
+    // Mapped input is decoded in place.
+    BitReader reader = input.isMapped()
+        ? BitReader(input.data() + headerSize, input.size() - headerSize)
+        : BitReader(in);
+    std::string buffer(DECODE_BUFFER_SIZE, '\0');
+    size_t outPos = 0;
+    uint64_t outSize = 0;
+    uint64_t codesRead = decode(reader, bits, dict, buffer, outPos, [&](size_t& pos, size_t need) {
+        FC_STAGE(Write);
+        out.write(buffer.data(), pos);
+        outSize += pos;
+        pos = 0;
+        if(need > buffer.size()) buffer.resize(need);
+    });
+    {
+        FC_STAGE(Write);
+        out.write(buffer.data(), outPos);
+        outSize += outPos;
+        output.close();
+    }
+    FC_COUNT(BytesIn, input.isMapped() ? input.size() : headerSize + reader.bytesPulled());
+    FC_COUNT(BytesOut, outSize);
 
     auto end = std::chrono::high_resolution_clock::now();
     double timeTaken = std::chrono::duration<double>(end - start).count();
 
-    auto inSize = std::filesystem::file_size(inputFile);
-    auto outSize = std::filesystem::file_size(outputFile);
+    Utils::log() << "✅ [LZW] Decompression complete.\n";
+    Utils::log() << "Codes: " << codesRead << " | Output: " << outSize << " bytes | ";
+    Utils::log() << "Time: " << timeTaken << "s\n";
+}
 
-    std::cout << "✅ [LZW] Decompression complete.\n";
-    std::cout << "Input: " << inSize << " bytes | Output: " << outSize << " bytes | ";
-    std::cout << "Time: " << timeTaken << "s\n";
-}
\ No newline at end of file
+void LZW::compressBuffer(const unsigned char* data, size_t size, std::string& out){
+    out = encodeHeader();
+    BitWriter writer(out, std::min<size_t>(IO_BUFFER_SIZE, size + 16));
+    size_t pos = 0;
+    encode([&](const unsigned char*& chunk) -> size_t {
+        size_t n = std::min(IO_BUFFER_SIZE, size - pos);
+        chunk = data + pos;
+        pos += n;
+        return n;
+    }, writer);
+}
+
+void LZW::decompressBuffer(const unsigned char* data, size_t size, std::string& out){
+    if(size < HEADER_SIZE){
+        throw std::runtime_error("Not an LZW stream (or a pre-versioned raw-int file)");
+    }
+    unsigned bits = parseHeader(reinterpret_cast<const char*>(data));
+    size_t headerSize = HEADER_SIZE;
+    const Dictionary* dict = nullptr;
+    if(isDictionaryStream(reinterpret_cast<const char*>(data))){
+        if(size < HEADER_SIZE + DICT_ID_SIZE){
+            throw std::runtime_error("Truncated LZW header");
+        }
+        dict = &dictionaryFor(reinterpret_cast<const char*>(data) + HEADER_SIZE, bits);
+        headerSize += DICT_ID_SIZE;
+    }
+    BitReader reader(data + headerSize, size - headerSize);
+
+    // Decode straight into `out`, growing it as phrases arrive.
+    out.resize(std::max<size_t>(4 * size, 256));
+    size_t outPos = 0;
+    decode(reader, bits, dict, out, outPos, [&](size_t& pos, size_t need) {
+        out.resize(std::max(2 * out.size(), pos + need));
+    });
+    out.resize(outPos);
+}
@@ -0,0 +1,163 @@
+#include "Pipeline.hpp"
+#include "Stats.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+BlockPipeline::BlockPipeline(int numThreads, size_t window)
+    : numThreads(std::max(1, numThreads)), window(std::max<size_t>(1, window)) {}
+
+size_t BlockPipeline::windowForMemory(size_t memoryLimit, size_t bytesPerBlock, int numThreads) {
+    size_t fit = bytesPerBlock ? memoryLimit / bytesPerBlock : 1;
+    size_t useful = 4 * static_cast<size_t>(std::max(1, numThreads));
+    return std::max<size_t>(1, std::min(fit, useful));
+}
+
+void BlockPipeline::checkIndex(std::istream& in, const BlockIndex& blocks, uint64_t indexOffset,
+                               const char* indexMagic) {
+    auto read = [&](auto& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        if (!in) {
+            throw std::runtime_error("Truncated block index");
+        }
+    };
+    uint32_t count = 0;
+    read(count);
+    if (count != blocks.size()) {
+        throw std::runtime_error("Block index does not match the stored blocks");
+    }
+    for (const auto& block : blocks) {
+        uint64_t rawOffset = 0, frameOffset = 0;
+        read(rawOffset);
+        read(frameOffset);
+        if (rawOffset != block.first || frameOffset != block.second) {
+            throw std::runtime_error("Block index does not match the stored blocks");
+        }
+    }
+    uint64_t storedOffset = 0;
+    char magic[4] = {};
+    read(storedOffset);
+    read(magic);
+    if (storedOffset != indexOffset || std::memcmp(magic, indexMagic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Block index footer damaged");
+    }
+}
+
+void BlockPipeline::run(const ReadFn& read, const WorkFn& work, const WriteFn& write) {
+    enum class State { Free, Filled, Working, Done };
+    struct Slot {
+        std::string input;
+        std::string output;
+        State state = State::Free;
+    };
+
+    // Block `seq` always lives in slots[seq % window]; the reader may only
+    // refill a slot after the writer has released the block before it.
+    std::vector<Slot> slots(window);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t produced = 0;
+    size_t nextWork = 0;
+    bool eof = false;
+    bool aborted = false;
+    std::exception_ptr failure;
+
+    // Waits that actually block are timed as stalls of the given stage.
+    auto await = [&](std::unique_lock<std::mutex>& lock, Stats::Stage stage, auto ready) {
+        if (ready()) return;
+#ifdef FC_STATS
+        Stats::ScopedStage stall(stage);
+#else
+        (void)stage;
+#endif
+        cv.wait(lock, ready);
+    };
+
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failure) failure = e;
+        aborted = true;
+        cv.notify_all();
+    };
+
+    std::thread reader([&]() {
+        Stats::setThreadRole("pipeline-reader");
+        try {
+            for (size_t seq = 0;; ++seq) {
+                Slot& slot = slots[seq % window];
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    await(lock, Stats::Stage::ReaderStall, [&]() { return aborted || slot.state == State::Free; });
+                    if (aborted) return;
+                }
+                bool more = read(slot.input);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!more) {
+                    eof = true;
+                } else {
+                    slot.state = State::Filled;
+                    produced = seq + 1;
+                }
+                cv.notify_all();
+                if (!more) return;
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numThreads; ++i) {
+        workers.emplace_back([&]() {
+            Stats::setThreadRole("pipeline-worker");
+            for (;;) {
+                size_t seq;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    await(lock, Stats::Stage::WorkerIdle, [&]() { return aborted || nextWork < produced || eof; });
+                    if (aborted || nextWork >= produced) return;
+                    seq = nextWork++;
+                    slots[seq % window].state = State::Working;
+                }
+                Slot& slot = slots[seq % window];
+                try {
+                    work(slot.input, slot.output);
+                } catch (...) {
+                    fail(std::current_exception());
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.state = State::Done;
+                cv.notify_all();
+            }
+        });
+    }
+
+    try {
+        for (size_t seq = 0;; ++seq) {
+            Slot& slot = slots[seq % window];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                await(lock, Stats::Stage::WriterStall, [&]() {
+                    return aborted || slot.state == State::Done || (eof && seq >= produced);
+                });
+                if (aborted || slot.state != State::Done) break;
+            }
+            write(slot.output);
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.state = State::Free;
+            cv.notify_all();
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    for (auto& t : workers) t.join();
+    if (failure) std::rethrow_exception(failure);
+}
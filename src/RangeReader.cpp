@@ -0,0 +1,145 @@
+#include "RangeReader.hpp"
+#include "Adaptive.hpp"
+#include "Huffman.hpp"
+#include "LZH.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    template <typename T>
+    T readField(std::istream& in) {
+        T value{};
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (!in) {
+            throw std::runtime_error("Truncated block index");
+        }
+        return value;
+    }
+}
+
+RangeReader::RangeReader(const std::string& inputFile) {
+    file.open(inputFile, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open input file: " + inputFile);
+    }
+    loadIndex(inputFile);
+}
+
+void RangeReader::loadIndex(const std::string& inputFile) {
+    char magic[4] = {};
+    uint8_t version = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+    const char* indexMagic = nullptr;
+    uint8_t expectedVersion = 0;
+    if (std::memcmp(magic, Huffman::BLOCK_MAGIC, sizeof(magic)) == 0) {
+        format = Format::HuffmanBlocks;
+        indexMagic = Huffman::INDEX_MAGIC;
+        expectedVersion = Huffman::BLOCK_VERSION;
+    } else if (std::memcmp(magic, Adaptive::BLOCK_MAGIC, sizeof(magic)) == 0) {
+        format = Format::Adaptive;
+        indexMagic = Adaptive::INDEX_MAGIC;
+        expectedVersion = Adaptive::BLOCK_VERSION;
+    } else if (std::memcmp(magic, LZH::BLOCK_MAGIC, sizeof(magic)) == 0) {
+        format = Format::LZH;
+        indexMagic = LZH::INDEX_MAGIC;
+        expectedVersion = LZH::BLOCK_VERSION;
+    }
+    if (!file || !indexMagic) {
+        throw std::runtime_error("No block index in " + inputFile
+                                 + "; random access needs huffman --threads N, lzh or auto output");
+    }
+    if (version != expectedVersion) {
+        throw std::runtime_error("Unsupported block container version: " + inputFile);
+    }
+    blockSize = readField<uint32_t>(file);
+
+    // Footer: indexOffset u64 | index magic; index: count u32 | (rawOffset u64, frameOffset u64)*
+    constexpr uint64_t footerSize = sizeof(uint64_t) + 4;
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    if (fileSize < footerSize + sizeof(uint32_t)) {
+        throw std::runtime_error("Truncated block container: " + inputFile);
+    }
+    file.seekg(static_cast<std::streamoff>(fileSize - footerSize));
+    uint64_t indexOffset = readField<uint64_t>(file);
+    file.read(magic, sizeof(magic));
+    if (!file || std::memcmp(magic, indexMagic, sizeof(magic)) != 0
+        || indexOffset > fileSize - footerSize - sizeof(uint32_t)) {
+        throw std::runtime_error("Block index missing or damaged: " + inputFile);
+    }
+
+    file.seekg(static_cast<std::streamoff>(indexOffset));
+    uint32_t count = readField<uint32_t>(file);
+    if (count > (fileSize - footerSize - indexOffset - sizeof(uint32_t)) / (2 * sizeof(uint64_t))) {
+        throw std::runtime_error("Block index missing or damaged: " + inputFile);
+    }
+    index.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        index[i].rawOffset = readField<uint64_t>(file);
+        index[i].frameOffset = readField<uint64_t>(file);
+        bool ordered = i == 0 ? index[i].rawOffset == 0
+                              : index[i].rawOffset > index[i - 1].rawOffset
+                                    && index[i].frameOffset > index[i - 1].frameOffset;
+        if (!ordered || index[i].frameOffset >= indexOffset) {
+            throw std::runtime_error("Block index missing or damaged: " + inputFile);
+        }
+    }
+
+    // Every frame starts with its raw size; the last one completes the total.
+    if (count > 0) {
+        file.seekg(static_cast<std::streamoff>(index.back().frameOffset));
+        rawSize = index.back().rawOffset + readField<uint32_t>(file);
+    }
+}
+
+const std::string& RangeReader::decodeBlock(size_t i) {
+    if (cachedBlock == i) return block;
+    cachedBlock = SIZE_MAX;
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(index[i].frameOffset));
+    bool present = false;
+    switch (format) {
+        case Format::HuffmanBlocks:
+            present = Huffman::readFrame(file, blockSize, frame);
+            if (present) Huffman::decodeBlock(frame.data(), frame.size(), block);
+            break;
+        case Format::Adaptive:
+            present = Adaptive::readFrame(file, blockSize, frame);
+            if (present) Adaptive::decodeBlock(frame, block);
+            break;
+        case Format::LZH:
+            present = LZH::readFrame(file, blockSize, frame);
+            if (present) LZH::decodeBlock(frame, block);
+            break;
+    }
+    uint64_t expected = (i + 1 < index.size() ? index[i + 1].rawOffset : rawSize) - index[i].rawOffset;
+    if (!present || block.size() != expected) {
+        throw std::runtime_error("Block index does not match the stored blocks");
+    }
+    decoded++;
+    cachedBlock = i;
+    return block;
+}
+
+void RangeReader::read(uint64_t offset, uint64_t length, std::string& out) {
+    out.clear();
+    if (offset >= rawSize || length == 0) return;
+    uint64_t end = offset + std::min(length, rawSize - offset);
+    out.reserve(static_cast<size_t>(end - offset));
+
+    // Last block starting at or before `offset`.
+    size_t i = std::upper_bound(index.begin(), index.end(), offset,
+                                [](uint64_t value, const Block& b) { return value < b.rawOffset; })
+               - index.begin() - 1;
+    for (; offset < end; ++i) {
+        const std::string& data = decodeBlock(i);
+        uint64_t blockStart = index[i].rawOffset;
+        uint64_t take = std::min<uint64_t>(end, blockStart + data.size()) - offset;
+        out.append(data, static_cast<size_t>(offset - blockStart), static_cast<size_t>(take));
+        offset += take;
+    }
+}
@@ -0,0 +1,186 @@
+#include "Stats.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    const char* const STAGE_NAMES[Stats::STAGE_COUNT] = {
+        "read", "histogram", "table", "encode", "decode", "write", "reader_stall", "worker_idle", "writer_stall",
+    };
+    const char* const COUNTER_NAMES[Stats::COUNTER_COUNT] = {
+        "bytes_in", "bytes_out", "blocks", "lzw_resets", "lzw_peak_codes", "lzw_code_capacity",
+    };
+
+    bool isPeak(size_t counter) {
+        return counter == static_cast<size_t>(Stats::Counter::LzwPeakCodes)
+               || counter == static_cast<size_t>(Stats::Counter::LzwCodeCapacity);
+    }
+
+    // One slot per thread that has recorded while enabled. Slots outlive
+    // their threads so pipeline workers still show up after they are joined.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Stats::ThreadRecord>> records;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    thread_local Stats::ThreadRecord* mine = nullptr;
+
+    bool recordedAnything(const Stats::ThreadRecord& r) {
+        for (uint64_t calls : r.stageCalls) {
+            if (calls) return true;
+        }
+        for (uint64_t value : r.counters) {
+            if (value) return true;
+        }
+        return false;
+    }
+
+    double seconds(uint64_t nanos) { return nanos / 1e9; }
+
+    void writeStages(std::ostream& out, const uint64_t* nanos, const uint64_t* calls, bool skipUnused) {
+        out << "{";
+        bool first = true;
+        for (size_t s = 0; s < Stats::STAGE_COUNT; ++s) {
+            if (skipUnused && !calls[s]) continue;
+            out << (first ? "" : ", ") << "\"" << STAGE_NAMES[s] << "\": {\"seconds\": " << seconds(nanos[s])
+                << ", \"calls\": " << calls[s] << "}";
+            first = false;
+        }
+        out << "}";
+    }
+}
+
+namespace Stats {
+    bool compiledIn() {
+#ifdef FC_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void setEnabled(bool on) {
+        if (on) reset();
+        enabledFlag().store(on, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto& record : r.records) {
+            const char* role = record->role;
+            *record = ThreadRecord();
+            record->role = role;
+        }
+        r.start = std::chrono::steady_clock::now();
+    }
+
+    ThreadRecord& local() {
+        if (!mine) {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.records.push_back(std::make_unique<ThreadRecord>());
+            mine = r.records.back().get();
+        }
+        return *mine;
+    }
+
+    void setThreadRole(const char* role) {
+        if (enabled()) local().role = role;
+    }
+
+    void writeJson(std::ostream& out) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start).count();
+
+        uint64_t nanos[STAGE_COUNT] = {};
+        uint64_t calls[STAGE_COUNT] = {};
+        uint64_t counters[COUNTER_COUNT] = {};
+        for (const auto& record : r.records) {
+            for (size_t s = 0; s < STAGE_COUNT; ++s) {
+                nanos[s] += record->stageNanos[s];
+                calls[s] += record->stageCalls[s];
+            }
+            for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+                counters[c] = isPeak(c) ? std::max(counters[c], record->counters[c])
+                                        : counters[c] + record->counters[c];
+            }
+        }
+
+        std::ios::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(6);
+        out << "{\n  \"compiled_in\": " << (compiledIn() ? "true" : "false") << ",\n";
+        out << "  \"wall_seconds\": " << wall << ",\n";
+        out << "  \"stages\": ";
+        writeStages(out, nanos, calls, false);
+        out << ",\n  \"counters\": {";
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            out << (c ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << counters[c];
+        }
+        const size_t peakCodes = static_cast<size_t>(Counter::LzwPeakCodes);
+        const size_t capacity = static_cast<size_t>(Counter::LzwCodeCapacity);
+        if (counters[capacity]) {
+            out << ", \"lzw_occupancy\": " << static_cast<double>(counters[peakCodes]) / counters[capacity];
+        }
+        out << "},\n  \"threads\": [";
+
+        bool first = true;
+        for (const auto& record : r.records) {
+            if (!recordedAnything(*record)) continue;
+            out << (first ? "\n" : ",\n") << "    {\"role\": \"" << record->role << "\", \"bytes_in\": "
+                << record->counters[static_cast<size_t>(Counter::BytesIn)] << ", \"bytes_out\": "
+                << record->counters[static_cast<size_t>(Counter::BytesOut)] << ", \"blocks\": "
+                << record->counters[static_cast<size_t>(Counter::Blocks)] << ", \"stages\": ";
+            writeStages(out, record->stageNanos, record->stageCalls, true);
+            out << "}";
+            first = false;
+        }
+        out << (first ? "]\n}\n" : "\n  ]\n}\n");
+        out.flags(flags);
+    }
+
+    void writeSummary(std::ostream& out) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::ios::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(4);
+        out << "📊 Stage times (seconds, summed over threads):\n";
+        for (size_t s = 0; s < STAGE_COUNT; ++s) {
+            uint64_t nanos = 0, calls = 0;
+            for (const auto& record : r.records) {
+                nanos += record->stageNanos[s];
+                calls += record->stageCalls[s];
+            }
+            if (calls) {
+                out << "  " << std::left << std::setw(13) << STAGE_NAMES[s] << std::right << std::setw(10)
+                    << seconds(nanos) << "  (" << calls << " calls)\n";
+            }
+        }
+        for (const auto& record : r.records) {
+            if (!recordedAnything(*record)) continue;
+            out << "  " << record->role << ": in " << record->counters[static_cast<size_t>(Counter::BytesIn)]
+                << " bytes, out " << record->counters[static_cast<size_t>(Counter::BytesOut)] << " bytes, "
+                << record->counters[static_cast<size_t>(Counter::Blocks)] << " blocks\n";
+        }
+        uint64_t resets = 0, peakCodes = 0, capacity = 0;
+        for (const auto& record : r.records) {
+            resets += record->counters[static_cast<size_t>(Counter::LzwResets)];
+            peakCodes = std::max(peakCodes, record->counters[static_cast<size_t>(Counter::LzwPeakCodes)]);
+            capacity = std::max(capacity, record->counters[static_cast<size_t>(Counter::LzwCodeCapacity)]);
+        }
+        if (capacity) {
+            out << "  LZW dictionary: peak " << peakCodes << " of " << capacity << " codes, " << resets
+                << " resets\n";
+        }
+        out.flags(flags);
+    }
+}
@@ -0,0 +1,115 @@
+#include "ThreadPool.hpp"
+#include "Stats.hpp"
+#include <algorithm>
+
+namespace {
+    // Which pool and deque the current thread works for, so nested submits
+    // stay local.
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(int numThreads) {
+    size_t count = static_cast<size_t>(std::max(1, numThreads));
+    for (size_t i = 0; i < count; ++i) queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < count; ++i) workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    // Tasks still queued here mean the owner is unwinding without wait();
+    // drop them rather than run them against its dying state.
+    failed = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(Task task) {
+    size_t target = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the pool mutex so a worker about to sleep cannot miss it.
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::take(size_t self, Task& task) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    currentPool = this;
+    currentQueue = self;
+    Stats::setThreadRole("pool-worker");
+    for (;;) {
+        Task task;
+        if (!take(self, task)) {
+            FC_STAGE(WorkerIdle);
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+            continue;
+        }
+
+        if (!failed) {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+                failed = true;
+            }
+        }
+        task = nullptr;
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::wait() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return pending == 0; });
+    }
+    if (failed) {
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = failure;
+            failure = nullptr;
+            failed = false;
+        }
+        std::rethrow_exception(error);
+    }
+}
@@ -2,25 +2,115 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "Adaptive.hpp"
+#include "Archive.hpp"
+#include "AsyncIO.hpp"
+#include "Dictionary.hpp"
+#include "FileIO.hpp"
 #include "Huffman.hpp"
+#include "LZH.hpp"
 #include "LZW.hpp"
+#include "RangeReader.hpp"
+#include "Stats.hpp"
+#include "Utils.hpp"
 
 bool VERBOSE = false;
+std::string STATS_FORMAT;
+
+#ifdef _WIN32
+const char* NULL_DEVICE = "NUL";
+#else
+const char* NULL_DEVICE = "/dev/null";
+#endif
+
+// `--dict` takes a dictionary file or the ID of one stored in the dictionary directory.
+std::shared_ptr<const Dictionary> loadDictionary(const std::string& spec, const std::string& dictDir)
+{
+    std::ifstream probe(spec, std::ios::binary);
+    if (probe)
+    {
+        return Dictionary::load(spec);
+    }
+    return Dictionary::load(Dictionary::pathFor(dictDir, Dictionary::parseId(spec)));
+}
+
+// After a successful run: the stage breakdown for --verbose, and the JSON
+// report for --stats json on stderr, so it never mixes with data or status
+// lines on stdout.
+void writeStats()
+{
+    if (VERBOSE)
+    {
+        Stats::writeSummary(Utils::log());
+    }
+    if (STATS_FORMAT == "json")
+    {
+        Stats::writeJson(std::cerr);
+    }
+}
+
+// Picks the codec for `-mode verify` from the file's magic number.
+std::string detectFormat(const std::string& inputFile)
+{
+    std::ifstream in(inputFile, std::ios::binary);
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    if (!in)
+    {
+        throw std::runtime_error("Could not read input file: " + inputFile);
+    }
+    const std::pair<const char*, const char*> formats[] = {
+        {"HFST", "huffman"}, {"HFBK", "huffman"}, {"HFDS", "huffman"}, {"LZWC", "lzw"},
+        {"LZWD", "lzw"},     {"LZHB", "lzh"},     {"ADBK", "auto"},    {"FCAR", "archive"},
+    };
+    for (const auto& format : formats)
+    {
+        if (std::memcmp(magic, format.first, sizeof(magic)) == 0)
+        {
+            return format.second;
+        }
+    }
+    throw std::runtime_error("Unrecognised compressed file: " + inputFile);
+}
 
 void printHelp()
 {
     std::cout << "\n📘 FileCompressor CLI — Usage Guide\n";
     std::cout << "----------------------------------\n";
     std::cout << "Usage:\n";
-    std::cout << "  ./compress -algo [huffman|lzw] -mode [compress|decompress] [options] <input> <output>\n\n";
+    std::cout << "  ./compress -algo [huffman|lzw|lzh|auto] -mode [compress|decompress] [options] <input> <output>\n\n";
+    std::cout << "  lzh  LZ77 matches and literals, Huffman coded (deflate-style)\n";
+    std::cout << "  auto picks Huffman, LZW or raw storage per block, whichever is smallest\n";
+    std::cout << "  ./compress -mode archive [-algo huffman|lzw|lzh] [options] <archive> <files/dirs...>\n";
+    std::cout << "  ./compress -mode extract [options] <archive> <output dir>\n";
+    std::cout << "  ./compress -mode verify [options] <compressed file or archive>\n";
+    std::cout << "  ./compress -mode train [--dict-dir DIR] [--max-bits N] <sample files/dirs...>\n\n";
+    std::cout << "  verify decodes everything and checks the CRC-32C checksums without writing output\n";
+    std::cout << "  train builds a shared Huffman/LZW dictionary for small payloads (one sample per file)\n\n";
     std::cout << "Options:\n";
     std::cout << "  --help            Show this help message and exit\n";
-    std::cout << "  --verbose         Enable detailed logs\n";
-    std::cout << "  --threads N       Number of threads (only for Huffman compression)\n\n";
+    std::cout << "  --verbose         Print per-stage times and per-thread byte counts after the run\n";
+    std::cout << "  --stats json      Write stage timings, counters and pipeline stalls as JSON to stderr\n";
+    std::cout << "  --threads N       Number of threads (Huffman, lzh and auto block compression/decompression)\n";
+    std::cout << "  --mem MB          Memory cap for blocks in flight (default 64)\n";
+    std::cout << "  --max-bits N      Largest LZW code width, 9-24 (default 16)\n";
+    std::cout << "  --range OFF:LEN   Decompress only LEN bytes starting at OFF (block containers)\n";
+    std::cout << "  --files-from F    Archive and train: read input paths from F, one per line (- for stdin)\n";
+    std::cout << "  --dict ID|FILE    Compress with a trained dictionary (huffman and lzw single streams)\n";
+    std::cout << "  --dict-dir DIR    Where train stores dictionaries and decompression finds them by ID (default .)\n";
+    std::cout << "  --io MODE         Background file I/O: auto (io_uring, else threads), uring, threads or off\n";
+    std::cout << "  -                 Use stdin/stdout in place of <input>/<output>\n\n";
     std::cout << "Examples:\n";
     std::cout << "  ./compress -algo huffman -mode compress input.txt output.bin\n";
     std::cout << "  ./compress -algo huffman -mode compress --threads 4 input.txt output.bin\n";
     std::cout << "  ./compress -algo lzw -mode decompress input.lzw output.txt\n";
+    std::cout << "  ./compress -mode archive --threads 8 logs.far /var/log/app\n";
+    std::cout << "  ./compress -mode verify --threads 4 output.bin\n";
+    std::cout << "  ./compress -mode train --dict-dir dicts samples/\n";
+    std::cout << "  ./compress -algo lzw -mode compress --dict-dir dicts --dict 1a2b3c4d record.json record.lzw\n";
+    std::cout << "  tar cf - dir | ./compress -algo huffman -mode compress --threads 4 - - > dir.tar.huff\n";
     std::cout << "----------------------------------\n";
 }
 
@@ -32,6 +122,8 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    std::ios::sync_with_stdio(false);
+    Utils::reportsEnabled() = true;
     std::vector<std::string> args(argv + 1, argv + argc);
 
     // handle --help
@@ -41,88 +133,433 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    // handle --verbose
-    if (std::find(args.begin(), args.end(), "--verbose") != args.end())
-    {
-        VERBOSE = true;
-        std::cout << "🔍 Verbose mode enabled.\n";
-    }
-
-    // validate required args
-    if (argc < 7)
-    {
-        std::cout << "Usage: ./compress -algo [huffman|lzw] -mode [compress|decompress] <input> <output>\n";
-        return 0;
-    }
-
-    std::string algo = argv[2];
-    std::string mode = argv[4];
-    std::string inputFile = argv[5];
-    std::string outputFile = argv[6];
+    std::string algo;
+    std::string mode;
+    std::vector<std::string> positional;
 
     // Default thread count
     int threadCount = 1;
+    size_t memoryLimitMB = 64;
+    unsigned lzwMaxBits = 16;
+    std::string filesFrom;
+    std::string rangeSpec;
+    std::string dictSpec;
+    std::string dictDir = ".";
 
-    // Find --threads flag
-    for (int i = 1; i < argc - 1; ++i)
+    // Flags may appear anywhere; everything else is <input> <output>
+    for (size_t i = 0; i < args.size(); ++i)
     {
-        if (std::string(argv[i]) == "--threads")
+        const std::string& arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (arg == "-algo" && hasValue)
+        {
+            algo = args[++i];
+        }
+        else if (arg == "-mode" && hasValue)
+        {
+            mode = args[++i];
+        }
+        else if (arg == "--threads" && hasValue)
         {
             try
             {
-                threadCount = std::stoi(argv[i + 1]);
+                threadCount = std::stoi(args[++i]);
             }
             catch (...)
             {
                 std::cerr << "Invalid thread count specified.\n";
                 return 1;
             }
+            if (threadCount < 1)
+            {
+                std::cerr << "Invalid thread count specified.\n";
+                return 1;
+            }
+        }
+        else if (arg == "--mem" && hasValue)
+        {
+            try
+            {
+                memoryLimitMB = std::stoul(args[++i]);
+            }
+            catch (...)
+            {
+                std::cerr << "Invalid memory limit specified.\n";
+                return 1;
+            }
+        }
+        else if (arg == "--max-bits" && hasValue)
+        {
+            try
+            {
+                lzwMaxBits = static_cast<unsigned>(std::stoul(args[++i]));
+            }
+            catch (...)
+            {
+                std::cerr << "Invalid LZW code width specified.\n";
+                return 1;
+            }
+        }
+        else if (arg == "--range" && hasValue)
+        {
+            rangeSpec = args[++i];
+        }
+        else if (arg == "--files-from" && hasValue)
+        {
+            filesFrom = args[++i];
+        }
+        else if (arg == "--dict" && hasValue)
+        {
+            dictSpec = args[++i];
+        }
+        else if (arg == "--dict-dir" && hasValue)
+        {
+            dictDir = args[++i];
+        }
+        else if (arg == "--stats" && hasValue)
+        {
+            STATS_FORMAT = args[++i];
+            if (STATS_FORMAT != "json")
+            {
+                std::cerr << "Unsupported stats format (expected json).\n";
+                return 1;
+            }
+        }
+        else if (arg == "--io" && hasValue)
+        {
+            IoQueue::Backend backend;
+            if (!IoQueue::parseBackend(args[++i], backend))
+            {
+                std::cerr << "Unsupported I/O backend (expected auto, uring, threads or off).\n";
+                return 1;
+            }
+            IoQueue::setBackend(backend);
         }
+        else if (arg == "--verbose")
+        {
+            VERBOSE = true;
+        }
+        else
+        {
+            positional.push_back(arg);
+        }
+    }
+
+    if (IoQueue::backend() == IoQueue::Backend::Uring && !IoQueue::create(1))
+    {
+        std::cerr << "Note: io_uring is not available here, file I/O stays synchronous.\n";
+    }
+
+    if (VERBOSE || !STATS_FORMAT.empty())
+    {
+        if (!Stats::compiledIn())
+        {
+            std::cerr << "Note: built with FILECOMPRESSOR_STATS=OFF, stage statistics are not recorded.\n";
+        }
+        Stats::setEnabled(true);
+        Stats::setThreadRole("main");
     }
 
-    if (algo == "huffman")
+    if (mode == "archive" || mode == "extract")
     {
-        Huffman h;
-        if (mode == "compress")
+        bool enoughArgs = mode == "archive" ? !positional.empty() && (positional.size() > 1 || !filesFrom.empty())
+                                            : positional.size() == 2;
+        if (!enoughArgs)
+        {
+            std::cout << "Usage: ./compress -mode archive [-algo huffman|lzw|lzh] <archive> <files/dirs...>\n";
+            std::cout << "       ./compress -mode extract <archive> <output dir>\n";
+            return 0;
+        }
+        if (Utils::isStdio(positional[0]) && mode == "archive")
         {
-            if (threadCount > 1)
+            Utils::stdoutCarriesData() = true;
+        }
+        try
+        {
+            Archive archive;
+            if (!algo.empty())
+            {
+                archive.setCodec(algo);
+            }
+            if (mode == "archive")
             {
-                std::cout << "🚀 Using " << threadCount << " threads for Huffman compression.\n";
-                h.compressMultiThreaded(inputFile, outputFile, threadCount);
+                std::vector<std::string> inputs(positional.begin() + 1, positional.end());
+                if (!filesFrom.empty())
+                {
+                    std::vector<std::string> listed = Archive::readFileList(filesFrom);
+                    inputs.insert(inputs.end(), listed.begin(), listed.end());
+                }
+                archive.create(positional[0], inputs, threadCount);
             }
             else
             {
-                h.compress(inputFile, outputFile);
+                archive.extract(positional[0], positional[1], threadCount);
             }
         }
-        else if (mode == "decompress")
+        catch (const std::exception &e)
         {
-            h.decompress(inputFile, outputFile);
+            std::cerr << "❌ Error: " << e.what() << "\n";
+            return 1;
         }
-        else
+        writeStats();
+        return 0;
+    }
+
+    if (mode == "train")
+    {
+        if (positional.empty() && filesFrom.empty())
         {
-            std::cerr << "Invalid mode.\n";
+            std::cout << "Usage: ./compress -mode train [--dict-dir DIR] [--max-bits N] <sample files/dirs...>\n";
+            return 0;
         }
+        try
+        {
+            Utils::Timer timer;
+            std::vector<std::string> inputs = positional;
+            if (!filesFrom.empty())
+            {
+                std::vector<std::string> listed = Archive::readFileList(filesFrom);
+                inputs.insert(inputs.end(), listed.begin(), listed.end());
+            }
+            std::vector<std::string> samples = Dictionary::readSamples(inputs);
+            std::shared_ptr<const Dictionary> dict = Dictionary::train(samples, lzwMaxBits);
+            std::string path = dict->save(dictDir);
+            Utils::log() << "✅ [Train] Dictionary " << Dictionary::formatId(dict->id()) << " written to " << path
+                         << "\n";
+            Utils::log() << "Samples: " << samples.size() << " | LZW phrases: " << dict->lzwPhrases().size()
+                         << " | Max bits: " << dict->lzwCodeBits() << " | Time: " << timer.stop() << "s\n";
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "❌ Error: " << e.what() << "\n";
+            return 1;
+        }
+        writeStats();
+        return 0;
     }
-    else if (algo == "lzw")
+
+    if (mode == "verify")
     {
-        LZW l;
-        if (mode == "compress")
+        if (positional.size() != 1)
         {
-            l.compress(inputFile, outputFile);
+            std::cout << "Usage: ./compress -mode verify [-algo huffman|lzw|lzh|auto] <input>\n";
+            return 0;
         }
-        else if (mode == "decompress")
+        const std::string& inputFile = positional[0];
+        try
         {
-            l.decompress(inputFile, outputFile);
+            if (algo.empty())
+            {
+                if (Utils::isStdio(inputFile))
+                {
+                    std::cerr << "Verifying stdin needs -algo.\n";
+                    return 1;
+                }
+                algo = detectFormat(inputFile);
+            }
+
+            // The codecs report their own decompression; only the verdict matters here.
+            Utils::Timer timer;
+            Utils::reportsEnabled() = false;
+            if (algo == "archive")
+            {
+                Archive().verify(inputFile, threadCount);
+            }
+            else if (algo == "huffman")
+            {
+                Huffman h;
+                h.setDictionaryDir(dictDir);
+                h.decompress(inputFile, NULL_DEVICE, threadCount);
+            }
+            else if (algo == "lzw")
+            {
+                LZW l;
+                l.setDictionaryDir(dictDir);
+                l.decompress(inputFile, NULL_DEVICE);
+            }
+            else if (algo == "lzh")
+            {
+                LZH().decompress(inputFile, NULL_DEVICE, threadCount);
+            }
+            else if (algo == "auto")
+            {
+                Adaptive().decompress(inputFile, NULL_DEVICE, threadCount);
+            }
+            else
+            {
+                std::cerr << "Unsupported algorithm.\n";
+                return 1;
+            }
+            Utils::reportsEnabled() = true;
+            Utils::log() << "✅ [Verify] OK: " << inputFile << " (" << algo << ") | Time: " << timer.stop() << "s\n";
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "❌ Verify failed: " << e.what() << "\n";
+            return 1;
+        }
+        writeStats();
+        return 0;
+    }
+
+    // validate required args
+    if (algo.empty() || mode.empty() || positional.size() != 2)
+    {
+        std::cout << "Usage: ./compress -algo [huffman|lzw|lzh|auto] -mode [compress|decompress] <input> <output>\n";
+        return 0;
+    }
+
+    std::string inputFile = positional[0];
+    std::string outputFile = positional[1];
+
+    // Keep stdout clean when it carries the compressed/restored data
+    if (Utils::isStdio(outputFile))
+    {
+        Utils::stdoutCarriesData() = true;
+    }
+    if (VERBOSE)
+    {
+        Utils::log() << "🔍 Verbose mode enabled.\n";
+    }
+
+    try
+    {
+        std::shared_ptr<const Dictionary> dictionary;
+        if (!dictSpec.empty())
+        {
+            bool singleStream = algo == "lzw" || (algo == "huffman" && threadCount == 1);
+            if (mode != "compress" || !singleStream)
+            {
+                std::cerr << "--dict applies to single-stream huffman and lzw compression.\n";
+                return 1;
+            }
+            dictionary = loadDictionary(dictSpec, dictDir);
+        }
+
+        if (!rangeSpec.empty())
+        {
+            if (mode != "decompress")
+            {
+                std::cerr << "--range applies to decompression only.\n";
+                return 1;
+            }
+            uint64_t offset = 0, length = 0;
+            size_t colon = rangeSpec.find(':');
+            try
+            {
+                if (colon == std::string::npos)
+                {
+                    throw std::invalid_argument(rangeSpec);
+                }
+                offset = std::stoull(rangeSpec.substr(0, colon));
+                length = std::stoull(rangeSpec.substr(colon + 1));
+            }
+            catch (...)
+            {
+                std::cerr << "Invalid range, expected OFFSET:LENGTH.\n";
+                return 1;
+            }
+
+            Utils::Timer timer;
+            RangeReader reader(inputFile);
+            std::string data = reader.read(offset, length);
+            OutputFile output(outputFile);
+            output.stream().write(data.data(), data.size());
+            output.close();
+            Utils::log() << "✅ [Range] Extracted " << data.size() << " bytes at offset " << offset << " | Blocks decoded: "
+                         << reader.blocksDecoded() << " of " << reader.blockCount() << " | Time: " << timer.stop()
+                         << "s\n";
+        }
+        else if (algo == "huffman")
+        {
+            Huffman h;
+            h.setMemoryLimit(memoryLimitMB << 20);
+            h.setDictionary(dictionary);
+            h.setDictionaryDir(dictDir);
+            if (mode == "compress")
+            {
+                if (threadCount > 1)
+                {
+                    Utils::log() << "🚀 Using " << threadCount << " threads for Huffman compression.\n";
+                    h.compressMultiThreaded(inputFile, outputFile, threadCount);
+                }
+                else
+                {
+                    h.compress(inputFile, outputFile);
+                }
+            }
+            else if (mode == "decompress")
+            {
+                h.decompress(inputFile, outputFile, threadCount);
+            }
+            else
+            {
+                std::cerr << "Invalid mode.\n";
+            }
+        }
+        else if (algo == "lzw")
+        {
+            LZW l;
+            l.setMaxCodeBits(lzwMaxBits);
+            l.setDictionary(dictionary);
+            l.setDictionaryDir(dictDir);
+            if (mode == "compress")
+            {
+                l.compress(inputFile, outputFile);
+            }
+            else if (mode == "decompress")
+            {
+                l.decompress(inputFile, outputFile);
+            }
+            else
+            {
+                std::cerr << "Invalid mode.\n";
+            }
+        }
+        else if (algo == "lzh")
+        {
+            LZH z;
+            z.setMemoryLimit(memoryLimitMB << 20);
+            if (mode == "compress")
+            {
+                z.compress(inputFile, outputFile, threadCount);
+            }
+            else if (mode == "decompress")
+            {
+                z.decompress(inputFile, outputFile, threadCount);
+            }
+            else
+            {
+                std::cerr << "Invalid mode.\n";
+            }
+        }
+        else if (algo == "auto")
+        {
+            Adaptive a;
+            a.setMemoryLimit(memoryLimitMB << 20);
+            if (mode == "compress")
+            {
+                a.compress(inputFile, outputFile, threadCount);
+            }
+            else if (mode == "decompress")
+            {
+                a.decompress(inputFile, outputFile, threadCount);
+            }
+            else
+            {
+                std::cerr << "Invalid mode.\n";
+            }
         }
         else
         {
-            std::cerr << "Invalid mode.\n";
+            std::cerr << "Unsupported algorithm.\n";
         }
     }
-    else
+    catch (const std::exception &e)
     {
-        std::cerr << "Unsupported algorithm.\n";
+        std::cerr << "❌ Error: " << e.what() << "\n";
+        return 1;
     }
+    writeStats();
     return 0;
 }
\ No newline at end of file